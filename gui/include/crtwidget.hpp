@@ -11,6 +11,9 @@ class CrtWidgetPrivate;
 /**
  * Displays a single frame as given by the back-end.
  *
+ * Frames are drawn straight into one of two indexed images, while the other
+ * one is on screen.  Presenting a frame only schedules a repaint.
+ *
  * \sa Ppu::SurfaceManager
  * \sa Core::Runner
  */
@@ -24,7 +27,9 @@ public:
   float scale() const;
   void setScale(float scale);
 
-  virtual void displayFrameBuffer(uint32_t *buffer) override;
+  FrameFormat frameFormat() const override;
+  void *acquireFrame() override;
+  void presentFrame(void *frame) override;
 
 signals:
 
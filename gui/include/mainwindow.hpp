@@ -31,6 +31,7 @@ public slots:
   void hardReset();
 
   void setScale(float scale);
+  void setRunAhead(int frames);
   bool eventFilter(QObject *, QEvent *event) override;
 
 private slots:
@@ -1,15 +1,25 @@
 #include <crtwidget.hpp>
 
+#include <ppu.hpp>
+
 #include <QPainter>
 
 namespace Gui {
 class CrtWidgetPrivate {
 public:
   float scale = 2.0;
-  QImage display;
+  QImage frames[2];
+  int display = 0; ///< Index of the frame on screen
 
   CrtWidgetPrivate() {
-    this->display = QImage(256, 240, QImage::Format_ARGB32);
+    QVector<QRgb> colors(256, 0xFFFF0000); // Red on OOB.
+    for (int i = 0; i < Ppu::COLOR_COUNT; i++) colors[i] = Ppu::COLORS[i];
+
+    for (QImage &frame : this->frames) {
+      frame = QImage(256, 240, QImage::Format_Indexed8);
+      frame.setColorTable(colors);
+      frame.fill(0);
+    }
   }
 };
 
@@ -29,24 +39,31 @@ float CrtWidget::scale() const {
 void CrtWidget::setScale(float scale) {
   this->d->scale = scale;
 
-  QImage &display = this->d->display;
+  const QImage &display = this->d->frames[this->d->display];
   this->setFixedSize(display.width() * scale, display.height() * scale);
   this->update();
 }
 
-void CrtWidget::displayFrameBuffer(uint32_t *buffer) {
-  const uchar *data = reinterpret_cast<uchar *>(buffer);
-  uchar *destination = this->d->display.bits();
-  ::memcpy(destination, data, 256 * 240 * sizeof(uint32_t));
+Ppu::SurfaceManager::FrameFormat CrtWidget::frameFormat() const {
+  return Indexed; // Drawn into the indexed images
+}
+
+void *CrtWidget::acquireFrame() {
+  // The color indices are stored without padding, as 256 is a multiple of 4.
+  return this->d->frames[this->d->display ^ 1].bits();
+}
 
-  this->repaint();
+void CrtWidget::presentFrame(void *frame) {
+  Q_UNUSED(frame);
+  this->d->display ^= 1;
+  this->update();
 }
 
 void CrtWidget::paintEvent(QPaintEvent *) {
   QPainter p(this);
 
   p.scale(this->d->scale, this->d->scale);
-  p.drawImage(0, 0, this->d->display);
+  p.drawImage(0, 0, this->d->frames[this->d->display]);
 }
 
 }
@@ -49,6 +49,7 @@ struct MainWindowPrivate {
   QAction *hardResetAction;
 
   int tickCount = 0;
+  int runAhead = 0;
 
   void updateActionState() {
     bool canRun = this->runner;
@@ -158,6 +159,7 @@ void MainWindow::openRom(const QString &path) {
     return;
   }
 
+  this->d->runner->setRunAhead(this->d->runAhead);
   this->setWindowTitle(QFileInfo(path).baseName());
   this->d->coreLabel->setText(cpuCore);
   this->reset(true);
@@ -205,6 +207,11 @@ void MainWindow::setScale(float scale) {
   QTimer::singleShot(0, [this]{ this->resize(0, 0); });
 }
 
+void MainWindow::setRunAhead(int frames) {
+  this->d->runAhead = frames;
+  if (this->d->runner) this->d->runner->setRunAhead(frames);
+}
+
 void MainWindow::keyPressEvent(QKeyEvent *event) {
   if (event->isAutoRepeat()) return;
 
@@ -269,6 +276,11 @@ void MainWindow::addMenus() {
   this->d->softResetAction = emuMenu->addAction(tr("Restart"), this, SLOT(reset()));
   this->d->hardResetAction = emuMenu->addAction(tr("Cold restart"), this, SLOT(reset()));
 
+  QMenu *runAheadMenu = emuMenu->addMenu(tr("Run-ahead"));
+  runAheadMenu->addAction(tr("Off"), [this]{ this->setRunAhead(0); });
+  runAheadMenu->addAction(tr("1 frame"), [this]{ this->setRunAhead(1); });
+  runAheadMenu->addAction(tr("2 frames"), [this]{ this->setRunAhead(2); });
+
   QMenu *scaleMenu = this->menuBar()->addMenu("&Skalierung");
   scaleMenu->addAction(tr("1x"), [this]{ this->setScale(1.0); });
   scaleMenu->addAction(tr("2x"), [this]{ this->setScale(2.0); });
@@ -3,7 +3,7 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 namespace Amd64 {
 using Stream = std::vector<uint8_t>;
@@ -468,13 +468,43 @@ enum Condition {
   Greater = NotLessOrEqual,
 };
 
+/**
+ * Identifies a block of an \c Assembler, or a symbol of a \c SymbolRegistry.
+ * Block labels are chosen by the user of the \c Assembler, while symbol labels
+ * are interned from the symbols name through \c symbol().
+ */
+struct Label {
+  /** Set in the \c id of symbol labels. */
+  static constexpr uint32_t SYMBOL = 1u << 31;
+
+  constexpr Label() = default;
+  constexpr explicit Label(uint32_t i) : id(i) { }
+
+  /** Returns the label of the symbol \a name.  Thread-safe. */
+  static Label symbol(const std::string &name);
+
+  /** Is this a valid label? */
+  constexpr bool isValid() const { return this->id != ~0u; }
+
+  /** Is this the label of a symbol? */
+  constexpr bool isSymbol() const { return this->isValid() && (this->id & SYMBOL); }
+
+  /** Returns a human readable name of this label, for diagnostics. */
+  std::string name() const;
+
+  constexpr bool operator==(Label other) const { return this->id == other.id; }
+  constexpr bool operator!=(Label other) const { return this->id != other.id; }
+
+  uint32_t id = ~0u;
+};
+
 /**
  * A reference in a \c Section to an internal or external symbol.  Basically a
- * named pointer resolved at link-time.
+ * labelled pointer resolved at link-time.
  */
 struct Reference {
-  /** Name of the referenced symbol. */
-  std::string name;
+  /** Label of the referenced block or symbol. */
+  Label label;
 
   /** Offset in the section byte stream */
   uintptr_t offset;
@@ -491,9 +521,13 @@ struct Reference {
    * used in.
    */
   uintptr_t base;
-};
 
-class Section; // For `struct Name`
+  /**
+   * Is this the rel32 displacement of a \c JMP or \c Jcc?  If so, the \c Linker
+   * may re-encode the jump, or drop it altogether.
+   */
+  bool jump = false;
+};
 
 /**
  * Reference to a memory and/or register.  Allows to also encode a displacement
@@ -505,32 +539,34 @@ class Section; // For `struct Name`
  * register.
  */
 class MemReg {
-  MemReg(std::string n, bool deref, int32_t disp, Register b, Register i, uint8_t s)
-    : name(n), displacement(disp), base(b), index(i), scale(s), dereference(deref)
+  MemReg(Label l, bool deref, int32_t disp, Register b, Register i, uint8_t s)
+    : label(l), displacement(disp), base(b), index(i), scale(s), dereference(deref)
   { this->sanityCheck(); }
 
 public:
-  MemReg(const Section &disp, Register base = NoRegister, Register index = NoRegister, uint8_t scale = 1);
-  MemReg(std::string disp, Register base = NoRegister, Register index = NoRegister, uint8_t scale = 1)
+  MemReg(Label disp, Register base = NoRegister, Register index = NoRegister, uint8_t scale = 1)
     : MemReg(disp, true, 0, base, index, scale) { }
+  MemReg(const std::string &disp, Register base = NoRegister, Register index = NoRegister, uint8_t scale = 1)
+    : MemReg(Label::symbol(disp), true, 0, base, index, scale) { }
   MemReg(const char *disp, Register base = NoRegister, Register index = NoRegister, uint8_t scale = 1)
-    : MemReg(disp, true, 0, base, index, scale) { }
+    : MemReg(Label::symbol(disp), true, 0, base, index, scale) { }
   MemReg(int32_t disp, Register base = NoRegister, Register index = NoRegister, uint8_t scale = 1)
-    : MemReg(std::string(), true, disp, base, index, scale) { }
+    : MemReg(Label(), true, disp, base, index, scale) { }
   MemReg(Register base, Register index = NoRegister, uint8_t scale = 1)
-    : MemReg(std::string(), true, 0, base, index, scale) { }
+    : MemReg(Label(), true, 0, base, index, scale) { }
 
   /**
    * Builds a value-reference:  This reference will be replaced by the \b value.
    * This may be dangerous to do.
    */
-  static MemReg value(const Section &symbol);
-  static MemReg value(std::string symbol)
+  static MemReg value(Label symbol)
   { return MemReg(symbol, false, 0, NoRegister, NoRegister, 1); }
+  static MemReg value(const std::string &symbol)
+  { return value(Label::symbol(symbol)); }
   static MemReg value(const char *symbol)
-  { return MemReg(symbol, false, 0, NoRegister, NoRegister, 1); }
+  { return value(Label::symbol(symbol)); }
   static MemReg value(Register reg)
-  { return MemReg(std::string(), false, 0, reg, NoRegister, 1); }
+  { return MemReg(Label(), false, 0, reg, NoRegister, 1); }
 
   /** Will this reference produce an immediate value? */
   bool isImmediate() const
@@ -544,7 +580,7 @@ public:
   void throwIfValue() const;
 
   // Displacement
-  std::string name;
+  Label label;
   int32_t displacement;
 
   // SIB
@@ -579,15 +615,10 @@ class Section {
   template<typename T>
   static constexpr uint8_t u8(T t, int shift = 0){ return static_cast<uint8_t>(t >> shift); }
 public:
-  Section(const std::string &name) : name(name) { }
-
-  /** The name of the section. */
-  const std::string name;
-
   /** The body of the section. */
   Stream bytes;
 
-  /** References, pointing into \c bytes. */
+  /** References, pointing into \c bytes.  Ordered by their offset. */
   std::vector<Reference> references;
 
   /** Returns the size (in Bytes) of this section. */
@@ -597,7 +628,13 @@ public:
    * Appends the body of \a other to this section.  Also appends the references
    * from \a other, adjusting their relative addresses automatically.
    */
-  void append(const Section &other);
+  void append(const Section &other) { this->append(other, size_t(0), other.size()); }
+
+  /**
+   * Appends \a length bytes of \a other, starting at \a begin, to this section
+   * along with the references which point into them.
+   */
+  void append(const Section &other, size_t begin, size_t length);
 
   /** Appends \a bytes to the section. */
   void append(const std::initializer_list<uint8_t> &bytes)
@@ -667,9 +704,9 @@ public:
   uintptr_t appendString(const std::string &string);
 
   /**
-   * Adds a named reference to a byte-range in the section.  The \a name is
-   * later looked-up at link-time, and the byte-range is replaced by that
-   * symbols value.
+   * Adds a labelled reference to a byte-range in the section.  The label of
+   * \a name is later looked-up at link-time, and the byte-range is replaced by
+   * that symbols value.
    *
    * The \a offset can be positive (in which case it points to an offset
    * relative to the beginning of the \b current start of the section).  If it
@@ -682,7 +719,7 @@ public:
   void addRef(const MemReg &name, intptr_t offset, size_t size, uintptr_t base = 0) {
     intptr_t s = static_cast<intptr_t>(this->bytes.size());
     uintptr_t off = static_cast<uintptr_t>((s + offset) % s);
-    this->references.push_back(Reference{ name.name, off, size, base });
+    this->references.push_back(Reference{ name.label, off, size, base });
   }
 
   /**
@@ -719,6 +756,7 @@ public:
   void emitMov(Register source, const MemReg &destination);
   void emitMov(const MemReg &source, Register destination);
   void emitMovzx(Register source, Register destination);
+  void emitNop(size_t count = 1);
   void emitOr(Register source, Register destination);
   void emitOr(uint32_t immediate, Register destination);
   void emitPopf() { this->append(POPF); }
@@ -759,25 +797,51 @@ private:
 };
 
 /**
- * The assembler class mainly manages named sections, which then hold
- * information of their respective instructions.
+ * The assembler manages the code of a single function.  All code is appended to
+ * a single section, which is divided into labelled blocks.  References between
+ * blocks are resolved by the \c Linker, which may also re-order the blocks.
  */
 class Assembler {
 public:
+  /** A labelled range of the \c code(). */
+  struct Block {
+    Label label;
+    size_t begin; ///< Offset of the first byte in the code.
+    size_t end; ///< Offset after the last byte in the code.
+
+    /**
+     * Is this block rarely executed?  Cold blocks are moved to the end of
+     * the function by the \c Linker, out of the way of the hot path.
+     */
+    bool cold;
+  };
+
   Assembler();
 
-  /** The sections int this assembler. */
-  const std::map<std::string, Section> &sections() const
-  { return this->m_sections; }
+  /** The code of all blocks, to which instructions are appended. */
+  Section &code() { return this->m_code; }
+  const Section &code() const { return this->m_code; }
 
   /**
-   * Returns the section \a name.  If no section called \a name exists, returns
-   * a new section instead.
+   * Starts the block \a label at the current end of the code, ending the
+   * previous block.  Throws if a block called \a label already exists.
    */
-  Section &section(const std::string &name);
+  Section &begin(Label label, bool cold = false);
+
+  /** Returns \c true if there's a block called \a label. */
+  bool has(Label label) const
+  { return this->m_index.find(label.id) != this->m_index.end(); }
+
+  /** Returns the index of the block \a label, or \c -1 if there's none. */
+  int indexOf(Label label) const;
+
+  /** The blocks in this assembler, in the order they were begun. */
+  std::vector<Block> blocks() const;
 
 private:
-  std::map<std::string, Section> m_sections;
+  Section m_code;
+  std::vector<Block> m_blocks;
+  std::unordered_map<uint32_t, int> m_index;
 };
 }
 
@@ -60,10 +60,13 @@ public:
   /** Is this memory block not in use? */
   bool isEmpty() const;
 
+  /** Alignment of allocated blocks, so code alignment carries over. */
+  static constexpr size_t ALIGNMENT = 16;
+
   /**
    * Tries to append the block beginning at \a bytes to this.  If there's not
    * enough space left returns \c -1.  Returns the offset from the beginning
-   * otherwise.
+   * otherwise.  The offset is a multiple of \c ALIGNMENT.
    */
   intptr_t allocate(const void *bytes, size_t len);
 
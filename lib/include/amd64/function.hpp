@@ -15,11 +15,8 @@ public:
   Function(const Analysis::Function &analyzed, MemoryManager &manager, void *funcPtr);
   ~Function();
 
-  /** The base function data. */
-  Analysis::Function &analyzed() { return this->m_analyzed; }
-
-  /** The base function data. */
-  const Analysis::Function &analyzed() const { return this->m_analyzed; }
+  /** Metadata of the base function. */
+  const Analysis::FunctionInfo &info() const { return this->m_info; }
 
   /**
    * Calls the function, using the data from \a state.  Upon return, the values
@@ -28,7 +25,7 @@ public:
   Cpu::State::Reason call(Cpu::State &state);
 
 private:
-  Analysis::Function m_analyzed;
+  Analysis::FunctionInfo m_info;
   MemoryManager &m_manager;
   void *m_funcPtr;
 };
@@ -4,7 +4,7 @@
 #include "assembler.hpp"
 #include "core_amd64.hpp"
 
-#include <analysis/branch.hpp>
+#include <analysis/function.hpp>
 
 namespace Amd64 {
 class SymbolRegistry;
@@ -18,8 +18,8 @@ class FunctionTranslator {
 public:
   FunctionTranslator();
 
-  /** Adds \a branch to the function. */
-  void addBranch(const Analysis::Branch &branch);
+  /** Adds \a branch of the analyzed \a func to the function. */
+  void addBranch(const Analysis::Function &func, const Analysis::Function::Branch &branch);
 
   /**
    * Finalizes the translation of this function.  Upon calling, the function
@@ -34,7 +34,6 @@ public:
 
 private:
   Assembler m_asm;
-  std::map<uint16_t, Section &> m_sections;
 };
 }
 
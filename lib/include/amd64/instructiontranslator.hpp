@@ -3,35 +3,54 @@
 
 #include "assembler.hpp"
 
-#include <analysis/branch.hpp>
+#include <analysis/function.hpp>
 
 #include <cpu.hpp>
 #include <cpu/state.hpp>
 
+#include <functional>
+
 namespace Amd64 {
 
 /**
  * Translator for individual 6502 instructions to AMD64 instructions.  A single
  * translator will only translate a single instruction.
+ *
+ * The instruction is appended to the current block of the assembler.  Cold
+ * blocks needed by the instruction are begun after it.
  */
 class InstructionTranslator {
 public:
-  InstructionTranslator(Section &section);
+  /** Kinds of blocks emitted for the 6502 instruction at an address. */
+  enum BlockKind : uint32_t {
+    InstructionBlock = 0x00000, ///< The instruction itself
+    ExitBlock = 0x10000, ///< Return to the host on cycle exhaustion
+    InterruptBlock = 0x20000, ///< Checks the pending interrupts
+  };
+
+  InstructionTranslator(Assembler &assembler);
+
+  /** Returns the label of the \a kind block of the instruction at \a address. */
+  static Label label(uint16_t address, BlockKind kind = InstructionBlock)
+  { return Label(kind | address); }
 
   /**
-   * Translates the \a instr at \a address.  Returns \c true if the instruction
-   * did \b NOT end in a branching-instruction.  Returns \c false if it did end
-   * in a branching instruction.
+   * Translates the instruction \a index of \a func.  Returns \c true if the
+   * instruction did \b NOT end in a branching-instruction.  Returns \c false if
+   * it did end in a branching instruction.
    */
-  std::pair<bool, uint16_t> translate(uint16_t address, const Analysis::Branch::Instruction &instr);
-  void translate(uint16_t address, Analysis::ConditionalInstruction instr);
+  std::pair<bool, uint16_t> translate(const Analysis::Function &func, size_t index);
+  void translate(uint16_t address, ::Core::Instruction instr, uint16_t truthy, uint16_t falsy);
   std::pair<bool, uint16_t> translate(uint16_t address, ::Core::Instruction instr);
 private:
+  Assembler &m_asm;
   Section &m_sec;
 
   void traceInstruction(uint16_t address, ::Core::Instruction instr);
   void logInstruction(uint16_t address, ::Core::Instruction instr);
   void adc(Register value);
+  void pollInterrupts(Label take);
+  void takeInterrupts(uint16_t address, std::function<void()> resume);
   void countCycles(int cycles);
   void compare(Register reg, Register mem);
   void setNz(uint8_t addMask = 0);
@@ -8,7 +8,7 @@ class SymbolRegistry;
 class MemoryManager;
 
 /**
- * Linker for output of an \c Assembler.  Combines the different sections of an
+ * Linker for output of an \c Assembler.  Combines the different blocks of an
  * assembler into a coherent stream of bytes, replacing bytes where necessary.
  *
  * A single \c Linker instance produces a \b single function.
@@ -16,16 +16,13 @@ class MemoryManager;
  */
 class Linker {
 public:
-  Linker(const std::string &entryPoint, SymbolRegistry &registry, MemoryManager &memory);
+  Linker(Label entryPoint, SymbolRegistry &registry, MemoryManager &memory);
 
-  /** Adds the \a section called \a name to the linker. */
-  void add(const std::string &name, const Section &section);
-
-  /** Adds all sections of the \a assembler to the linker. */
+  /** Sets the \a assembler whose blocks are linked. */
   void add(const Assembler &assembler);
 
   /**
-   * Links the sections and symbols into the memory manager.
+   * Links the blocks and symbols into the memory manager.
    *
    * If \a dumpDisassembly is \c true, will send the generated code through
    * `objdump(1)` to show a nice disassembly.
@@ -33,12 +30,12 @@ public:
   void *link(bool dumpDisassembly = false);
 
 private:
-  std::string m_entryPoint;
+  Label m_entryPoint;
   SymbolRegistry &m_registry;
   MemoryManager &m_memory;
-  std::map<std::string, const Section&> m_sections;
+  const Assembler *m_assembler = nullptr;
 
-  std::pair<Section, std::map<std::string, uintptr_t>> mergeSections();
+  std::pair<Section, std::vector<uintptr_t>> mergeSections();
 };
 }
 
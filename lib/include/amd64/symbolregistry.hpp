@@ -1,7 +1,9 @@
 #ifndef AMD64_SYMBOLREGISTRY_HPP
 #define AMD64_SYMBOLREGISTRY_HPP
 
-#include <map>
+#include "assembler.hpp"
+
+#include <unordered_map>
 
 namespace Amd64 {
 
@@ -70,12 +72,20 @@ public:
    * exception.
    */
   Symbol get(const std::string &name);
+  Symbol get(Label label);
 
   /** Returns \c true if there's a symbol called \a name. */
   bool has(const std::string &name);
+  bool has(Label label);
+
+  /**
+   * Returns the symbol \a label, or \c nullptr if there's no such symbol.
+   * The pointer is valid until the registry is changed.
+   */
+  const Symbol *find(Label label) const;
 
 private:
-  std::map<std::string, Symbol> m_symbols;
+  std::unordered_map<uint32_t, Symbol> m_symbols;
 };
 }
 
@@ -1,39 +1,89 @@
 #ifndef ANALYSIS_FUNCTION_HPP
 #define ANALYSIS_FUNCTION_HPP
 
-#include <QMap>
+#include <core/instruction.hpp>
+#include <QString>
+
+#include <vector>
 
 namespace Analysis {
-class Branch;
+
+/**
+ * Metadata of an analyzed function.  This is all a compiled function needs to
+ * keep around once its instructions were translated.
+ */
+struct FunctionInfo {
+  /** Cartridge specific configuration tag, for caching. */
+  uint64_t tag = 0;
+
+  /** Start address of this function. */
+  uint16_t begin = 0;
+
+  /** Lowest and highest address of the instructions in this function. */
+  uint16_t low = 0;
+  uint16_t high = 0;
+
+  /** Can this function be cached? */
+  bool cacheable = false;
+
+  /** Start addresses of all branches, in ascending order. */
+  std::vector<uint16_t> branches;
+
+  /** Does the function have instructions in the range of \a address? */
+  bool covers(uint16_t address) const
+  { return address >= this->low && address <= this->high; }
+};
 
 /**
  * Container for data of an analyzed function.
+ *
+ * The instructions of all branches are stored in flat arrays, one per field,
+ * and are referred to by their index.  A branch is a range of these indices.
+ * Instructions which start more than one branch are stored once per branch.
+ *
+ * A \c Function is meant to be re-used through \c reset(), which keeps the
+ * allocated storage around for the next analysis.
  */
 class Function {
 public:
-  Function(uint64_t tag, uint16_t begin, bool cacheable);
-  ~Function();
+  /** Branch of the function: The instructions up to a branching one. */
+  struct Branch {
+    uint16_t start; ///< Address of the first instruction
+    uint32_t begin; ///< Index of the first instruction
+    uint32_t end; ///< Index after the last instruction
+  };
 
-  /** Branches of this function. */
-  const QMap<uint16_t, Branch *> &branches() const;
+  Function(uint64_t tag = 0, uint16_t begin = 0, bool cacheable = false);
 
-  /** Branch at \a address.  If no branch is found, returns \c nullptr. */
-  Branch *branch(uint16_t address);
+  /** Clears the function, and starts over with the new identity. */
+  void reset(uint64_t tag, uint16_t begin, bool cacheable);
+
+  /** Branches of this function, ordered by their start address. */
+  const std::vector<Branch> &branches() const { return this->m_branches; }
 
   /** Branch at \a address.  If no branch is found, returns \c nullptr. */
   const Branch *branch(uint16_t address) const;
 
-  /** Start address of this function. */
-  uint16_t begin() const;
+  /** The root branch of the function, where execution starts. */
+  const Branch *root() const { return this->branch(this->m_begin); }
 
-  /** Cartridge specific configuration tag, for caching. */
-  uint64_t tag() const;
+  /** Count of instructions in all branches. */
+  size_t size() const { return this->m_addresses.size(); }
 
-  /** The root branch of the function, where execution starts. */
-  Branch *root();
+  /** Address of the instruction \a index. */
+  uint16_t address(size_t index) const { return this->m_addresses[index]; }
 
-  /** Adds \a branch to the function. */
-  void add(Branch *branch);
+  /** The instruction \a index. */
+  Core::Instruction instruction(size_t index) const {
+    return Core::Instruction(this->m_commands[index], this->m_modes[index],
+                             this->m_cycles[index], this->m_operands[index]);
+  }
+
+  /** Start address of this function. */
+  uint16_t begin() const { return this->m_begin; }
+
+  /** Cartridge specific configuration tag, for caching. */
+  uint64_t tag() const { return this->m_tag; }
 
   /** Native name of this function in memory */
   QString nativeName() const;
@@ -41,12 +91,41 @@ public:
   /** Can this function be cached? */
   bool cacheable() const { return this->m_cacheable; }
 
+  /** Returns the metadata of this function. */
+  FunctionInfo info() const;
+
+  /**
+   * Starts a new branch at \a start.  Instructions appended from now on are
+   * part of it.
+   */
+  void beginBranch(uint16_t start);
+
+  /** Appends the \a instr at \a address to the current branch. */
+  void append(uint16_t address, const Core::Instruction &instr);
+
+  /**
+   * Has a branch at \a address been begun?  Unlike \c branch(), this also works
+   * while the function is still being built.
+   */
+  bool hasBranch(uint16_t address) const;
+
+  /** Ends building the function.  Orders the branches by their address. */
+  void finish();
+
 private:
   uint64_t m_tag;
   uint16_t m_begin;
-  QMap<uint16_t, Branch *> m_branches;
   bool m_cacheable;
+
+  std::vector<Branch> m_branches;
+
+  // Instructions
+  std::vector<uint16_t> m_addresses;
+  std::vector<Core::Instruction::Command> m_commands;
+  std::vector<Core::Instruction::Addressing> m_modes;
+  std::vector<uint8_t> m_cycles;
+  std::vector<uint16_t> m_operands;
 };
 }
 
-#endif // DYNAREC_FUNCTION_HPP
+#endif // ANALYSIS_FUNCTION_HPP
@@ -12,10 +12,14 @@ struct FunctionDisassemblerImpl;
  */
 class FunctionDisassembler {
 public:
-  FunctionDisassembler(Core::Data::Ptr &data);
+  FunctionDisassembler(const Core::Data::Ptr &data);
   ~FunctionDisassembler();
 
-  Analysis::Function disassemble(uint16_t address);
+  /**
+   * Disassembles the function starting at \a address into \a func.  The
+   * previous contents of \a func are discarded, but its storage is re-used.
+   */
+  void disassemble(uint16_t address, Function &func);
 
 private:
   FunctionDisassemblerImpl *impl;
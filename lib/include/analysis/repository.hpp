@@ -36,7 +36,7 @@ public:
   typedef std::function<FuncT*(Analysis::Function&)> Packer;
 
   explicit Repository(const Core::Data::Ptr &mem, Packer packer, int cacheSize = DEFAULT_CACHE_SIZE)
-    : m_memory(mem), m_packer(packer), m_cache(cacheSize)
+    : m_memory(mem), m_packer(packer), m_cache(cacheSize), m_disassembler(mem)
   { }
 
   /**
@@ -56,8 +56,10 @@ public:
     FuncT *compiled = this->m_cache.object(key);
 
     if (!compiled) {
-      FunctionDisassembler disasm(this->m_memory);
-      Function base = disasm.disassemble(address);
+      // The analyzed function is only needed while packing, so its storage
+      // is re-used for the next one.
+      Function &base = this->m_analysis;
+      this->m_disassembler.disassemble(address, base);
       compiled = this->m_packer(base);
 
       if (base.cacheable()) this->m_cache.insert(key, compiled);
@@ -73,6 +75,8 @@ private:
   Core::Data::Ptr m_memory;
   Packer m_packer;
   QCache<CacheKey, FuncT> m_cache;
+  FunctionDisassembler m_disassembler;
+  Function m_analysis;
 };
 }
 
@@ -2,6 +2,7 @@
 #define CARTRIDGE_BASE_HPP
 
 #include <core/inesfile.hpp>
+#include <core/savestate.hpp>
 #include <ppu.hpp>
 #include <memory>
 
@@ -41,11 +42,57 @@ public:
   /** Writes \a value into PRG at \a address. */
   virtual void write(int address, uint8_t value) = 0;
 
-  /** Reads from CHR at \a address. */
-  virtual uint8_t readChr(int address) = 0;
+  /**
+   * Creates a copy of the cartridge in its current state, sharing the ROM
+   * with this one.  \sa Core::Runner::fork()
+   */
+  virtual Ptr clone() const = 0;
+
+  /**
+   * Writes the mapper state into \a out: Its registers, and the content of
+   * its RAM.  ROM is not part of it.  The default implementation writes
+   * nothing, for mappers without any state.
+   */
+  virtual void saveState(Core::StateWriter &out) const;
+
+  /**
+   * Restores the mapper state written by \c saveState() from \a in, and
+   * updates the mapping accordingly.
+   */
+  virtual void loadState(Core::StateReader &in);
 
-  /** Writes \a value into CHR at \a address. */
-  virtual void writeChr(int address, uint8_t value) = 0;
+  /**
+   * Page table of the PPU address space, in pages of \c Ppu::PAGE_SIZE.  The
+   * pattern tables map into CHR memory, the name tables into the memory set
+   * through \c setNameTableMemory().  The palettes at
+   * \c Ppu::PALETTES_BASE are not covered by it.
+   *
+   * The table itself stays at the same address for the lifetime of the
+   * cartridge, only its entries change on bank switches.
+   */
+  const uint8_t *const *ppuPages() const
+  { return this->m_ppuPages; }
+
+  /**
+   * Page table for writes into the PPU address space.  Same as \c ppuPages(),
+   * but pages which can't be written to are \c nullptr.
+   */
+  uint8_t *const *ppuWritePages() const
+  { return this->m_ppuWritePages; }
+
+  /**
+   * Returns the 1KiB page of CHR memory currently mapped at \a address.  The
+   * pointer identifies the physical memory, and stays valid for the lifetime
+   * of the cartridge.
+   */
+  const uint8_t *chrPage(int address) const
+  { return this->m_ppuPages[address / Ppu::PAGE_SIZE]; }
+
+  /**
+   * Sets the PPU \a memory the name tables are mapped into.  It has to be
+   * large enough for four name tables.
+   */
+  void setNameTableMemory(uint8_t *memory);
 
   /** The currently active name table mirroring mode. */
   Ppu::Mirroring nameTableMirroring() const
@@ -58,7 +105,26 @@ public:
   static Ptr createById(int id, const Core::InesFile &ines);
 
 protected:
+  /** Constructs a cartridge not backed by a ROM, using \a mirroring. */
+  explicit Base(Ppu::Mirroring mirroring);
+
+  /**
+   * Maps the CHR \a page, counting from \c 0 at \c 0x0000, to \a data.  If
+   * \a writable is \c false, writes to it are ignored.
+   */
+  void mapChr(int page, uint8_t *data, bool writable);
+
+  /** Changes the name table mirroring to \a mode. */
+  void setNameTableMirroring(Ppu::Mirroring mode);
+
   Ppu::Mirroring m_nameTableMirroring;
+
+private:
+  void mapNameTables();
+
+  uint8_t *m_nameTableMemory = nullptr;
+  const uint8_t *m_ppuPages[Ppu::PAGE_COUNT] = { };
+  uint8_t *m_ppuWritePages[Ppu::PAGE_COUNT] = { };
 };
 }
 
@@ -19,8 +19,9 @@ public:
   uint64_t tag() const override;
   uint8_t read(int address) override;
   void write(int address, uint8_t value) override;
-  uint8_t readChr(int address) override;
-  void writeChr(int address, uint8_t value) override;
+  Base::Ptr clone() const override;
+  void saveState(Core::StateWriter &out) const override;
+  void loadState(Core::StateReader &in) override;
 
 private:
   struct Bank {
@@ -39,9 +40,11 @@ private:
     }
   };
 
+  uint8_t *writableRam();
   void writeRegister(int address, uint8_t value);
   void updateRegister(int address, uint8_t value);
   void updateCharMapping();
+  void mapCharBanks();
   void updateProgramMapping();
 
   Core::InesFile m_ines;
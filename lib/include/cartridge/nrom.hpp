@@ -13,14 +13,12 @@ public:
   uint64_t tag() const override;
   uint8_t read(int address) override;
   void write(int address, uint8_t value) override;
-  uint8_t readChr(int address) override;
-  void writeChr(int address, uint8_t value) override;
+  Base::Ptr clone() const override;
 
 private:
   QByteArray banks[2];
   uint8_t *m_prgFirst;
   uint8_t *m_prgSecond;
-  uint8_t *m_chrFirst;
 };
 }
 
@@ -0,0 +1,54 @@
+#ifndef CARTRIDGE_SHADOW_HPP
+#define CARTRIDGE_SHADOW_HPP
+
+#include "base.hpp"
+
+#include <unordered_map>
+
+namespace Cartridge {
+
+/**
+ * Stand-in for a cartridge, backing a copy of the PPU memory on another
+ * thread.  \sa Ppu::WriteLog
+ *
+ * Follows the CHR mapping of the live cartridge as told through \c mapPage().
+ * CHR ROM is shared with the live cartridge, as it never changes.  CHR RAM is
+ * copied by \c sync(), and from then on only changes through writes into the
+ * PPU memory using this cartridge.
+ *
+ * It has no PRG memory, as the CPU never sees it.
+ */
+class Shadow : public Base {
+public:
+  Shadow(const Base::Ptr &live);
+  ~Shadow() override;
+
+  QString name() const override;
+  uint64_t tag() const override;
+  uint8_t read(int address) override;
+  void write(int address, uint8_t value) override;
+  Base::Ptr clone() const override;
+
+  /**
+   * Copies the CHR mapping, CHR RAM and name table mirroring of the live
+   * cartridge.  It must not change while doing so.
+   */
+  void sync();
+
+  /**
+   * Maps the CHR \a page to the \a live page of the live cartridge, or to its
+   * copy for CHR RAM.
+   */
+  void mapPage(int page, const uint8_t *live);
+
+  using Base::setNameTableMirroring;
+
+private:
+  Base::Ptr m_live;
+
+  /** Copies of the CHR RAM pages, by their live page. */
+  std::unordered_map<const uint8_t *, std::unique_ptr<uint8_t[]>> m_ram;
+};
+}
+
+#endif // CARTRIDGE_SHADOW_HPP
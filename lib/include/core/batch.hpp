@@ -0,0 +1,80 @@
+#ifndef CORE_BATCH_HPP
+#define CORE_BATCH_HPP
+
+#include "inesfile.hpp"
+
+namespace Core {
+class Runner;
+struct BatchPrivate;
+
+/**
+ * Runs many emulator instances of the same ROM side by side, like for
+ * automated testing or machine learning.
+ *
+ * The instances are split up between a pool of worker threads.  Each
+ * instance is created, stepped and destroyed by the same worker, so its
+ * memory stays local to it.  The batch doesn't use the Qt event loop.
+ *
+ * After each \c step(), the RAM of all instances, and optionally their last
+ * frame, are available in contiguous buffers.
+ */
+class Batch {
+public:
+  /**
+   * Creates \a count instances running \a ines on the CPU core \a cpuType,
+   * using \a threads worker threads.  If \a threads is \c 0, one per hardware
+   * thread is used.
+   */
+  Batch(const InesFile &ines, const QString &cpuType, int count, int threads = 0);
+  ~Batch();
+
+  /** Count of instances. */
+  int count() const;
+
+  /** Count of worker threads. */
+  int threadCount() const;
+
+  /**
+   * Are frames drawn into \c frames()?  Off by default, in which case frames
+   * are emulated without drawing them.  \sa Core::Runner::tick()
+   */
+  bool drawFrames() const;
+  void setDrawFrames(bool draw);
+
+  /**
+   * Advances all instances by \a frames, and waits for them to finish.  The
+   * gamepads of instance \c i are set to \c firstPlayer[i] and
+   * \c secondPlayer[i] before, or released if either is \c nullptr.  Only the
+   * last frame is drawn.  If an instance throws, the first exception is
+   * rethrown after all workers are done.  \sa Core::Gamepad::setButtons()
+   */
+  void step(const uint8_t *firstPlayer, const uint8_t *secondPlayer = nullptr, int frames = 1);
+
+  /** Resets all instances.  \sa Core::Runner::reset() */
+  void reset(bool hard = true);
+
+  /**
+   * The RAM of all instances as of the last \c step(), with
+   * \c Cpu::Memory::RAM_SIZE bytes for each instance.
+   */
+  const uint8_t *ram() const;
+
+  /**
+   * The frames of all instances as of the last \c step() which drew frames,
+   * with one Byte per pixel indexing into \c Ppu::COLORS, and
+   * \c Ppu::Renderer::WIDTH times \c Ppu::Renderer::HEIGHT pixels each.
+   */
+  const uint8_t *frames() const;
+
+  /**
+   * Returns the runner of the instance at \a index, for example to save its
+   * state.  Must not be used while \c step() runs.
+   */
+  Runner *runner(int index);
+
+private:
+  BatchPrivate *d;
+};
+}
+
+#endif // CORE_BATCH_HPP
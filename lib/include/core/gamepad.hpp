@@ -21,6 +21,26 @@ public:
   /** Clears all button presses. */
   void reset();
 
+  /**
+   * State of all buttons, one bit each in the order the NES reads them:
+   * A, B, Select, Start, Up, Down, Left, Right, starting at the lowest bit.
+   */
+  uint8_t buttons() const
+  { return this->m_state; }
+
+  void setButtons(uint8_t buttons)
+  { this->m_state = buttons; }
+
+  /**
+   * Count of buttons already shifted out by \c read() since the last strobe.
+   * Unlike the buttons, which are live input, this is part of a save state.
+   */
+  uint8_t serialPosition() const
+  { return this->m_pos; }
+
+  void setSerialPosition(uint8_t position)
+  { this->m_pos = position; }
+
   /** Fetches the next serial state byte. */
   uint8_t read();
 
@@ -0,0 +1,86 @@
+#ifndef CORE_REWINDBUFFER_HPP
+#define CORE_REWINDBUFFER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Core {
+/**
+ * Ring of past emulator states for rewinding, frame by frame.
+ *
+ * Only the newest state is kept as a whole.  Each older one is kept as the
+ * XOR of it and its successor, with runs of unchanged bytes left out.  As
+ * XOR is its own inverse, stepping back applies the newest delta onto the
+ * newest state, so no key frames are needed, and the oldest delta can be
+ * dropped at any time.
+ *
+ * All memory is allocated up-front.  Once either the count of frames or the
+ * space for the deltas runs out, the oldest frames are dropped.
+ * \sa Core::Runner::setRewindLength()
+ */
+class RewindBuffer {
+public:
+  /**
+   * Creates a buffer for states of \a stateSize bytes, keeping up to
+   * \a frames deltas in \a capacity bytes.
+   */
+  RewindBuffer(int stateSize, int frames, int capacity);
+  ~RewindBuffer();
+
+  /** Buffer the next state is written into, before calling \c record(). */
+  uint8_t *next()
+  { return this->m_next.get(); }
+
+  /**
+   * Makes the state in \c next() the newest one, keeping the previous one as
+   * delta against it.
+   */
+  void record();
+
+  /**
+   * Steps back to the previous state, which is then returned by \c current().
+   * Returns \c false if there's none.
+   */
+  bool stepBack();
+
+  /** The newest state, or \c nullptr if nothing was recorded yet. */
+  const uint8_t *current() const
+  { return this->m_hasCurrent ? this->m_current.get() : nullptr; }
+
+  /** Count of frames \c stepBack() can go back. */
+  int depth() const
+  { return this->m_count; }
+
+  /** Drops all states. */
+  void clear();
+
+private:
+  struct Record {
+    int offset;
+    int size;
+  };
+
+  void reserve(int size);
+  void dropOldest();
+  int encode(uint8_t *out) const;
+  void decode(const uint8_t *in, int size);
+
+  int m_stateSize;
+  int m_maxDeltaSize;
+  std::unique_ptr<uint8_t[]> m_current;
+  std::unique_ptr<uint8_t[]> m_next;
+  bool m_hasCurrent = false;
+
+  std::unique_ptr<uint8_t[]> m_deltas;
+  int m_capacity;
+  int m_head = 0; ///< Offset the next delta is written to
+  std::unique_ptr<uint8_t[]> m_scratch; ///< The delta being encoded
+
+  std::vector<Record> m_records;
+  int m_first = 0; ///< Index of the oldest record
+  int m_count = 0;
+};
+}
+
+#endif // CORE_REWINDBUFFER_HPP
@@ -2,6 +2,7 @@
 #define CORE_RUNNER_HPP
 
 #include <QObject>
+#include <memory>
 #include "inesfile.hpp"
 
 struct RunnerPrivate;
@@ -12,10 +13,17 @@ class Memory;
 }
 
 namespace Cpu {
+  class Base;
   class Memory;
 }
 
+namespace Cartridge {
+class Base;
+}
+
 namespace Core {
+class Scheduler;
+struct Timing;
 
 /**
  * Facade class constructing and maintaining the NES emulation back-end.
@@ -32,6 +40,18 @@ public:
   explicit Runner(const InesFile &ines, const QString &cpuType, Ppu::SurfaceManager *surfaces, QObject *parent = nullptr);
   ~Runner() override;
 
+  /**
+   * Creates a copy of this runner in its current state, showing frames on
+   * \a surfaces.  Must be called between frames.
+   *
+   * The fork shares all that is immutable with this runner: The ROM, and on
+   * cores which support it, the instructions predecoded from ROM.  The RAM of
+   * the cartridge is shared until either one writes to it.  The fork starts
+   * without rewinding, run-ahead or threaded rendering.  Both runners may run
+   * on different threads.  \sa Cpu::Base::shareCode()
+   */
+  Runner *fork(Ppu::SurfaceManager *surfaces, QObject *parent = nullptr) const;
+
   /** The used ines file. */
   InesFile ines() const;
 
@@ -41,9 +61,75 @@ public:
   /** Pointer to the memory as seen by the PPU. */
   Ppu::Memory *vram();
 
+  /** The CPU core. */
+  Cpu::Base *cpu();
+
   /** The used CPU core name. */
   const QString &cpuImplementation() const;
 
+  /**
+   * Event scheduler driving the emulation.  Components can add timed events
+   * to it, with deadlines on the master clock.
+   */
+  Scheduler *scheduler();
+
+  /** Timing of the emulated TV system. */
+  const Timing &timing() const;
+
+  /**
+   * Are frames drawn on a separate thread?  Off by default.
+   * \sa Ppu::Renderer::setThreaded()
+   */
+  bool threadedRendering() const;
+  void setThreadedRendering(bool threaded);
+
+  /** Size of a save state in bytes.  Stays the same for the loaded ROM. */
+  int stateSize() const;
+
+  /**
+   * Writes the complete emulator state into \a buffer, which has to hold
+   * \c stateSize() bytes: The CPU registers and RAM, the PPU registers and
+   * memory, the mapper state, and the time of the scheduler.  Must be called
+   * between frames.
+   */
+  void saveState(uint8_t *buffer) const;
+
+  /**
+   * Restores the emulator state written by \c saveState() from \a buffer of
+   * \a size bytes.  Must be called between frames.  Throws a
+   * \c std::runtime_error if it's not a save state of this version, or of
+   * another mapper, leaving the emulator state undefined if it was truncated.
+   */
+  void loadState(const uint8_t *buffer, int size);
+
+  /**
+   * Count of past frames kept for rewinding.  \c 0, the default, disables
+   * rewinding.  Changing it drops all kept frames.  \sa Core::RewindBuffer
+   */
+  int rewindLength() const;
+  void setRewindLength(int frames);
+
+  /** Count of frames \c rewind() can currently go back. */
+  int rewindDepth() const;
+
+  /**
+   * Steps back to the state before the last \c tick().  Returns \c false if
+   * no earlier frame is kept.  Must be called between frames.
+   */
+  bool rewind();
+
+  /**
+   * Count of frames emulated ahead on each \c tick(), to hide the input lag
+   * of games reacting to input only in the following frames.  After emulating
+   * the frame, its state is saved, the next frames are emulated without
+   * drawing them except for the last one, which is shown instead, and then
+   * the saved state is restored.  \c 0, the default, disables it.
+   *
+   * With threaded rendering, the shown frame still lags behind by a frame.
+   */
+  int runAhead() const;
+  void setRunAhead(int frames);
+
 public slots:
   /**
    * Resets the internal state.  \b Must be called before calling \c tick() the
@@ -52,11 +138,17 @@ public slots:
   void reset(bool hard = true);
 
   /**
-   * Advances the simulation by one frame.
+   * Advances the simulation by one frame.  If \a skipRaster is \c true, the
+   * frame is emulated without drawing it, and the surface manager is not
+   * given a new frame, and no frames are run ahead.
+   * \sa Ppu::Renderer::setSkipRaster()
    */
-  void tick();
+  void tick(bool skipRaster = false);
 
 private:
+  Runner(const Runner &from, Ppu::SurfaceManager *surfaces, QObject *parent);
+  void setup(const std::shared_ptr<Cartridge::Base> &cartridge, Ppu::SurfaceManager *surfaces);
+
   RunnerPrivate *d;
 };
 }
@@ -0,0 +1,81 @@
+#ifndef CORE_SAVESTATE_HPP
+#define CORE_SAVESTATE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Core {
+/**
+ * Writes the state of emulator components into a flat buffer, one after
+ * another.  Without a buffer, it only counts the bytes which would've been
+ * written.  \sa Core::Runner::saveState()
+ */
+class StateWriter {
+public:
+  explicit StateWriter(uint8_t *buffer = nullptr) : m_buffer(buffer) { }
+
+  /** Writes \a size bytes of \a data. */
+  void write(const void *data, int size) {
+    if (this->m_buffer) ::memcpy(this->m_buffer + this->m_size, data, size);
+    this->m_size += size;
+  }
+
+  /** Writes the \a value as is. */
+  template<typename T>
+  void write(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Value must be trivially copyable");
+    this->write(&value, sizeof(T));
+  }
+
+  /** Count of bytes written so far. */
+  int size() const
+  { return this->m_size; }
+
+private:
+  uint8_t *m_buffer;
+  int m_size = 0;
+};
+
+/**
+ * Reads the state of emulator components from a flat buffer, in the order
+ * the \c StateWriter wrote them.  Throws a \c std::runtime_error if the
+ * buffer is too short.
+ */
+class StateReader {
+public:
+  StateReader(const uint8_t *buffer, int size) : m_buffer(buffer), m_size(size) { }
+
+  /** Reads \a size bytes into \a data. */
+  void read(void *data, int size) {
+    ::memcpy(data, this->take(size), size);
+  }
+
+  /** Returns the next \a size bytes in the buffer, and skips them. */
+  const uint8_t *take(int size) {
+    if (size > this->m_size - this->m_pos) throw std::runtime_error("Save state is truncated");
+    const uint8_t *data = this->m_buffer + this->m_pos;
+    this->m_pos += size;
+    return data;
+  }
+
+  /** Reads into \a value as is. */
+  template<typename T>
+  void read(T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Value must be trivially copyable");
+    this->read(&value, sizeof(T));
+  }
+
+  /** Count of bytes not read yet. */
+  int remaining() const
+  { return this->m_size - this->m_pos; }
+
+private:
+  const uint8_t *m_buffer;
+  int m_size;
+  int m_pos = 0;
+};
+}
+
+#endif // CORE_SAVESTATE_HPP
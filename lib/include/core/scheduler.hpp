@@ -0,0 +1,83 @@
+#ifndef CORE_SCHEDULER_HPP
+#define CORE_SCHEDULER_HPP
+
+#include <core/savestate.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Core {
+/**
+ * Queue of timed events, ordered by their deadline on the master clock.
+ *
+ * Components, like the PPU or a mapper with an IRQ counter, add their event
+ * once through \c add(), and then schedule it to a deadline as needed.  The
+ * runner lets the CPU run until the next deadline, advances the clock by the
+ * time it actually took, and then dispatches all events which are due.
+ * \sa Core::Timing
+ */
+class Scheduler {
+public:
+  typedef std::function<void()> Handler;
+
+  /** Deadline of events which aren't scheduled. */
+  static constexpr int64_t NEVER = INT64_MAX;
+
+  Scheduler();
+  ~Scheduler();
+
+  /**
+   * Adds an event calling \a handler, not scheduled yet.  Returns its id.
+   * Must not be called from within a handler.
+   */
+  int add(const Handler &handler);
+
+  /** Schedules the \a event to be dispatched once the clock is at \a deadline. */
+  void schedule(int event, int64_t deadline);
+
+  /** Cancels the \a event if it's scheduled. */
+  void cancel(int event);
+
+  /** Current time of the master clock. */
+  int64_t now() const
+  { return this->m_now; }
+
+  /** Deadline of the next scheduled event, or \c NEVER. */
+  int64_t nextDeadline() const
+  { return this->m_next; }
+
+  /** Advances the clock by \a ticks. */
+  void advance(int64_t ticks)
+  { this->m_now += ticks; }
+
+  /**
+   * Dispatches all events which are due, in the order of their deadlines.
+   * Handlers may schedule events again.
+   */
+  void dispatch();
+
+  /** Writes the clock and the deadlines of all events into \a out. */
+  void saveState(Core::StateWriter &out) const;
+
+  /**
+   * Restores the clock and the deadlines written by \c saveState() from
+   * \a in.  The same events have to be added in the same order.
+   */
+  void loadState(Core::StateReader &in);
+
+private:
+  struct Event {
+    Handler handler;
+    int64_t deadline;
+  };
+
+  void updateNext();
+
+  std::vector<Event> m_events;
+  int64_t m_now = 0;
+  int64_t m_next = NEVER;
+};
+}
+
+#endif // CORE_SCHEDULER_HPP
@@ -0,0 +1,41 @@
+#ifndef CORE_TIMING_HPP
+#define CORE_TIMING_HPP
+
+#include <cstdint>
+
+namespace Core {
+/**
+ * Timing of a TV system.
+ *
+ * Times are counted in ticks of the master clock, which the clocks of both
+ * the CPU and the PPU are divided from.
+ */
+struct Timing {
+  int cpuDivider; ///< Master clock ticks per CPU cycle
+  int ppuDivider; ///< Master clock ticks per PPU dot
+  int dotsPerLine; ///< PPU dots per scan line
+  int linesPerFrame; ///< Scan lines per frame, including the pre-render line
+
+  /** Length of a scan line in master clock ticks. */
+  constexpr int64_t lineLength() const
+  { return int64_t(this->ppuDivider) * this->dotsPerLine; }
+
+  /** Length of a frame in master clock ticks. */
+  constexpr int64_t frameLength() const
+  { return this->lineLength() * this->linesPerFrame; }
+
+  /** Count of CPU cycles taking at least \a ticks master clock ticks. */
+  constexpr int64_t cpuCycles(int64_t ticks) const
+  { return (ticks + this->cpuDivider - 1) / this->cpuDivider; }
+
+  /** Timing of NTSC systems: 21.477 MHz master clock, 60 frames per second. */
+  static constexpr Timing ntsc()
+  { return Timing{ 12, 4, 341, 262 }; }
+
+  /** Timing of PAL systems: 26.602 MHz master clock, 50 frames per second. */
+  static constexpr Timing pal()
+  { return Timing{ 16, 5, 341, 312 }; }
+};
+}
+
+#endif // CORE_TIMING_HPP
@@ -34,6 +34,21 @@ public:
    */
   virtual void jump(uint16_t address) = 0;
 
+  /**
+   * Drops code the core cached from the RAM, after it was replaced behind the
+   * core's back, like when restoring a save state.  Code cached from ROM stays
+   * valid, as it's looked up by the cartridge tag.  Does nothing by default.
+   */
+  virtual void invalidateRamCode();
+
+  /**
+   * Shares the code cached from ROM with \a from, a core of the same type
+   * running a copy of the same cartridge.  Both cores may run on different
+   * threads afterwards.  Must not be called while \a from is running.  Does
+   * nothing by default.  \sa Core::Runner::fork()
+   */
+  virtual void shareCode(const Base *from);
+
   /** Jumps to the vector of \a intr without further checks. */
   void jumpToVector(Interrupt intr);
 
@@ -47,6 +62,24 @@ public:
    */
   void interrupt(Interrupt intr, bool force = false);
 
+  /**
+   * Raises the \a intr line.  Unlike \c interrupt(), this doesn't take the
+   * interrupt right away.  Instead the core takes it by itself the next time it
+   * checks for pending interrupts, which spares it from having to sync its
+   * state just for this.  The line is cleared once the interrupt was taken.
+   *
+   * \sa servicePending()
+   */
+  void raise(Interrupt intr);
+
+  /**
+   * Takes the pending interrupt with the highest priority which is not masked.
+   * Returns \c true if an interrupt was taken.
+   *
+   * \sa raise()
+   */
+  bool servicePending();
+
   /** Pulls a 8-bit integer from the guest stack. */
   uint8_t pull();
 
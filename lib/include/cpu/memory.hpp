@@ -33,6 +33,15 @@ public:
   /** Re-initializes the memory for a cold start. */
   void reset();
 
+  /**
+   * Writes the RAM and the serial state of the gamepads into \a out.  The
+   * held buttons are live input and not part of it.
+   */
+  void saveState(Core::StateWriter &out) const;
+
+  /** Restores the state written by \c saveState() from \a in. */
+  void loadState(Core::StateReader &in);
+
   /** Returns the RAM pointer. */
   uint8_t *ram() { return this->m_ram; }
 
@@ -28,6 +28,9 @@ struct State {
 
     /** An unknown instruction was encountered. */
     UnknownInstruction = 5,
+
+    /** A pending interrupt was noticed, see \c interrupts. */
+    Interrupt = 6,
   };
 
   uint8_t a = 0; ///< Accumulator
@@ -38,6 +41,7 @@ struct State {
   int32_t cycles = 0; ///< Remaining cycles.
   uint16_t pc = 0; ///< Program Counter
   Reason reason = Reason::Return; ///< Last exit reason, unused by the interpret
+  uint8_t interrupts = 0; ///< Pending interrupt lines, see Cpu::Base::raise()
 
   Flags flags() const { return Flags(this->p); }
   void setFlags(Flags f) { this->p = f; }
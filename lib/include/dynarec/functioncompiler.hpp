@@ -5,8 +5,6 @@
 #include "common.hpp"
 #include "functionframe.hpp"
 
-namespace Analysis { class Branch; }
-
 namespace Dynarec {
 
 struct FunctionCompilerImpl;
@@ -34,8 +32,8 @@ public:
   /** Frame of the currently compiled function. */
   FunctionFrame &frame();
 
-  /** Compiles the given \a branch. */
-  llvm::BasicBlock *compileBranch(Analysis::Branch *branch);
+  /** Compiles the branch starting at \a start. */
+  llvm::BasicBlock *compileBranch(uint16_t start);
 
 private:
 
@@ -2,7 +2,7 @@
 #define DYNAREC_INSTRUCTIONTRANSLATOR_HPP
 
 #include "common.hpp"
-#include <analysis/branch.hpp>
+#include <core/instruction.hpp>
 
 namespace Dynarec {
 class FunctionCompiler;
@@ -15,7 +15,7 @@ public:
   InstructionTranslator(FunctionCompiler &compiler, llvm::Function *func);
 
   /** Translates the instruction. */
-  llvm::BasicBlock *translate(Builder &b, uint16_t address, const Analysis::Branch::Instruction &instr);
+  llvm::BasicBlock *translate(Builder &b, uint16_t address, const Core::Instruction &instr);
 private:
   FunctionCompiler &m_compiler;
   llvm::Function *m_func;
@@ -0,0 +1,36 @@
+#ifndef INTERPRET_CORE_THREADED_HPP
+#define INTERPRET_CORE_THREADED_HPP
+
+#include <cpu/base.hpp>
+#include <cpu/state.hpp>
+#include <cpu/memory.hpp>
+
+class ThreadedCoreImpl;
+
+namespace Interpret {
+
+/**
+ * CPU Core implementation using a threaded-code interpreter.
+ *
+ * Instructions are decoded only once into a cache of handlers with their
+ * operands already resolved, keyed by the memory tag and the address.  Each
+ * handler then jumps straight to the handler of the next instruction.  Cached
+ * instructions in RAM are dropped as soon as the guest writes to their page.
+ */
+class ThreadedCore : public Cpu::Base {
+  Q_OBJECT
+public:
+  ThreadedCore(const Cpu::Memory::Ptr &mem, Cpu::State state = Cpu::State(), QObject *parent = nullptr);
+  ~ThreadedCore() override;
+
+  virtual int run(int cycles) override;
+  virtual void jump(uint16_t address) override;
+  virtual void invalidateRamCode() override;
+  virtual void shareCode(const Cpu::Base *from) override;
+
+private:
+  ThreadedCoreImpl *impl;
+};
+}
+
+#endif // INTERPRET_CORE_THREADED_HPP
@@ -0,0 +1,40 @@
+#ifndef INTERPRET_HOOKPOLICY_HPP
+#define INTERPRET_HOOKPOLICY_HPP
+
+#include <cpu/hook.hpp>
+
+namespace Interpret {
+/**
+ * Hook policy of the interpreter loops when no \c Cpu::Hook is installed.
+ * Everything in here compiles down to nothing.
+ *
+ * A hook policy offers the static \c enabled constant, which tells if the
+ * interpreter has to prepare the instruction for the hook at all, and the
+ * \c beforeInstruction and \c afterInstruction methods of \c Cpu::Hook.
+ */
+struct NoHook {
+  static constexpr bool enabled = false;
+
+  explicit NoHook(Cpu::Hook *) { }
+
+  void beforeInstruction(const ::Core::Instruction &, Cpu::State &) { }
+  void afterInstruction(const ::Core::Instruction &, Cpu::State &) { }
+};
+
+/** Hook policy passing every instruction on to the installed \c Cpu::Hook. */
+struct CallHook {
+  static constexpr bool enabled = true;
+
+  explicit CallHook(Cpu::Hook *hook) : hook(hook) { }
+
+  void beforeInstruction(const ::Core::Instruction &instr, Cpu::State &state)
+  { this->hook->beforeInstruction(instr, state); }
+
+  void afterInstruction(const ::Core::Instruction &instr, Cpu::State &state)
+  { this->hook->afterInstruction(instr, state); }
+
+  Cpu::Hook *hook;
+};
+}
+
+#endif // INTERPRET_HOOKPOLICY_HPP
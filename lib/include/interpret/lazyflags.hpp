@@ -0,0 +1,81 @@
+#ifndef INTERPRET_LAZYFLAGS_HPP
+#define INTERPRET_LAZYFLAGS_HPP
+
+#include <cpu.hpp>
+
+namespace Interpret {
+/**
+ * Lazily evaluated Negative, Zero, Carry and Overflow flags.
+ *
+ * Instead of updating the PSW after every instruction, the interpreters only
+ * store the last result, and the operands of the last addition.  The flags are
+ * then evaluated when they're tested, or \c apply()'d to the PSW whenever the P
+ * register is observed from the outside.  All other flags stay in the PSW.
+ */
+struct LazyFlags {
+  static constexpr uint8_t MASK = static_cast<uint8_t>(Cpu::Flag::Negative)
+                                | static_cast<uint8_t>(Cpu::Flag::Zero)
+                                | static_cast<uint8_t>(Cpu::Flag::Carry)
+                                | static_cast<uint8_t>(Cpu::Flag::Overflow);
+
+  uint8_t n = 0; ///< Negative if bit 7 is set
+  uint8_t z = 1; ///< Zero if this is \c 0
+  uint8_t c = 0; ///< Carry, \c 0 or \c 1
+  uint8_t vLeft = 0; ///< Left operand of the last addition
+  uint8_t vRight = 0; ///< Right operand of the last addition
+  uint8_t vResult = 0; ///< Result of the last addition
+
+  bool negative() const { return (this->n & 0x80) != 0; }
+  bool zero() const { return this->z == 0; }
+  bool carry() const { return this->c != 0; }
+
+  /** This is how the 6502 calculates the overflow bit. */
+  bool overflow() const
+  { return (~(this->vLeft ^ this->vRight) & (this->vLeft ^ this->vResult) & 0x80) != 0; }
+
+  /** Updates the Negative and Zero flags, and returns \a value. */
+  uint8_t setNz(uint8_t value) {
+    this->n = this->z = value;
+    return value;
+  }
+
+  void setCarry(bool active) { this->c = active ? 1 : 0; }
+
+  void setOverflow(bool active) {
+    this->vLeft = this->vRight = 0;
+    this->vResult = active ? 0x80 : 0;
+  }
+
+  /**
+   * Remembers the addition of \a left and \a right, with the result being
+   * \a value.  Updates all lazy flags, and returns the lower byte of \a value.
+   */
+  uint8_t setNvzc(uint8_t left, uint8_t right, uint16_t value) {
+    this->vLeft = left;
+    this->vRight = right;
+    this->vResult = static_cast<uint8_t>(value);
+    this->c = (value > 0xFF) ? 1 : 0;
+    return this->setNz(static_cast<uint8_t>(value));
+  }
+
+  /** Returns the PSW \a p with the evaluated flags. */
+  uint8_t apply(uint8_t p) const {
+    p &= ~MASK;
+    if (this->negative()) p |= static_cast<uint8_t>(Cpu::Flag::Negative);
+    if (this->zero()) p |= static_cast<uint8_t>(Cpu::Flag::Zero);
+    if (this->carry()) p |= static_cast<uint8_t>(Cpu::Flag::Carry);
+    if (this->overflow()) p |= static_cast<uint8_t>(Cpu::Flag::Overflow);
+    return p;
+  }
+
+  /** Takes the flags from the PSW \a p. */
+  void load(uint8_t p) {
+    this->n = p & static_cast<uint8_t>(Cpu::Flag::Negative);
+    this->z = (p & static_cast<uint8_t>(Cpu::Flag::Zero)) ? 0 : 1;
+    this->c = (p & static_cast<uint8_t>(Cpu::Flag::Carry)) ? 1 : 0;
+    this->setOverflow((p & static_cast<uint8_t>(Cpu::Flag::Overflow)) != 0);
+  }
+};
+}
+
+#endif // INTERPRET_LAZYFLAGS_HPP
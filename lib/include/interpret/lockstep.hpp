@@ -0,0 +1,74 @@
+#ifndef INTERPRET_LOCKSTEP_HPP
+#define INTERPRET_LOCKSTEP_HPP
+
+#include <cpu/state.hpp>
+#include <cpu/memory.hpp>
+#include <vector>
+
+class LockStepImpl;
+
+namespace Interpret {
+
+/**
+ * Experimental interpreter running the CPUs of up to 16 instances of the same
+ * ROM in lock-step, like for evaluating many instances with different inputs.
+ *
+ * The registers and the RAM of all instances are interleaved into lanes, 8 or
+ * 16 of them, so a RAM access is a single vector load or store for all lanes.
+ * Each instruction is decoded once, and then executed on all lanes which are
+ * at the same address, with the lane loops written for the compiler to
+ * vectorize.  The other lanes are masked off.  The lanes with the lowest
+ * address always go first, so lanes which took different branches converge
+ * again.  Accesses outside of the RAM go to the memory of each lane.
+ *
+ * This behaves like \c Interpret::Core, including its timing, but doesn't
+ * implement hooks.  The RAM of each memory is copied in at the start of each
+ * \c run(), and back out at its end.
+ */
+class LockStep {
+public:
+  /** Maximum count of lanes. */
+  static constexpr int MAX_LANES = 16;
+
+  /**
+   * Runs a CPU on each of the \a memories, all starting in the default state.
+   * Throws a \c std::runtime_error if there are none, or more than
+   * \c MAX_LANES.  Doesn't take ownership of the memories.
+   */
+  explicit LockStep(const std::vector<Cpu::Memory *> &memories);
+  ~LockStep();
+
+  /** Count of lanes in use, one for each memory. */
+  int lanes() const;
+
+  /** Count of lanes executed at once: 8 or 16. */
+  int width() const;
+
+  /**
+   * The state of the CPU of \a lane.  Its \c cycles are those left over from
+   * the last \c run(), which may be negative.
+   */
+  Cpu::State state(int lane) const;
+  void setState(int lane, const Cpu::State &state);
+
+  /** Raises the \a intr line of \a lane.  \sa Cpu::Base::raise() */
+  void raise(int lane, Cpu::Interrupt intr);
+
+  /** Advances the CPU of each lane by at least \a cycles. */
+  void run(int cycles);
+
+  /** Count of instructions executed so far, summed up over all lanes. */
+  uint64_t instructions() const;
+
+  /**
+   * Count of instructions decoded so far.  Each one was executed on one or
+   * more lanes at once.
+   */
+  uint64_t dispatches() const;
+
+private:
+  LockStepImpl *impl;
+};
+}
+
+#endif // INTERPRET_LOCKSTEP_HPP
@@ -19,7 +19,7 @@ public:
   CodeGenerator(Machine machine = Lua53);
   ~CodeGenerator();
 
-  std::string translate(Analysis::Function &func);
+  std::string translate(const Analysis::Function &func);
 private:
   MachineSpecifics *m_machine;
 };
@@ -15,11 +15,8 @@ public:
   Function(const Analysis::Function &analyzed, lua_State *lua, int ref);
   ~Function();
 
-  /** The base function data. */
-  Analysis::Function &analyzed() { return this->m_analyzed; }
-
-  /** The base function data. */
-  const Analysis::Function &analyzed() const { return this->m_analyzed; }
+  /** Metadata of the base function. */
+  const Analysis::FunctionInfo &info() const { return this->m_info; }
 
   /** Function reference id in the Lua state. */
   int ref() const { return this->m_ref; }
@@ -28,7 +25,7 @@ public:
   void pushOntoStack();
 
 private:
-  Analysis::Function m_analyzed;
+  Analysis::FunctionInfo m_info;
   lua_State *m_lua;
   int m_ref;
 };
@@ -135,6 +135,15 @@ namespace Ppu {
   /** Total addressable memory of the PPU. */
   static constexpr int TOTAL_SIZE = 0x4000;
 
+  /** Size of a page in the PPU address space. */
+  static constexpr int PAGE_SIZE = 1024; // 1KiB
+
+  /** Count of pages in the PPU address space. */
+  static constexpr int PAGE_COUNT = TOTAL_SIZE / PAGE_SIZE;
+
+  /** Address of the color palettes, not part of the page table. */
+  static constexpr int PALETTES_BASE = 0x3F00;
+
   /** Memory address of the first pattern table. */
   static constexpr int PATTERN_TABLE0 = 0x0000;
 
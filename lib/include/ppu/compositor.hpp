@@ -0,0 +1,104 @@
+#ifndef PPU_COMPOSITOR_HPP
+#define PPU_COMPOSITOR_HPP
+
+#include <ppu.hpp>
+#include <ppu/tilecache.hpp>
+
+#include <cstring>
+
+namespace Ppu {
+/**
+ * Scan line compositing routines of the renderer.
+ *
+ * Vectorized routines have a scalar reference implementation, and variants
+ * picked at run-time for the host CPU.  All produce the exact same output.
+ */
+namespace Compositor {
+static_assert(sizeof(Palette) == 4, "Palette should be 4 byte wide");
+
+/**
+ * Draws \a count tiles from \a slices into \a output, 8 pixels per tile.  The
+ * colors of the \c N'th tile are looked up in the palette of \a palettes at
+ * index \c attributes[N].  The \c N'th byte of \a opaque is set to a bitmap
+ * of the opaque pixels of that tile, with bit \c X standing for pixel \c X.
+ *
+ * The output pixels are indices into \c Ppu::COLORS.
+ */
+void drawTiles(const TileSlice *slices, const uint8_t *attributes,
+               const Palette *palettes, int count,
+               uint8_t *output, uint8_t *opaque);
+
+/** Scalar reference implementation of \c drawTiles(). */
+void drawTilesScalar(const TileSlice *slices, const uint8_t *attributes,
+                     const Palette *palettes, int count,
+                     uint8_t *output, uint8_t *opaque);
+
+/**
+ * Converts \a count pixels in \a input, being indices into \c Ppu::COLORS,
+ * into ARGB colors in \a output.  Indices out of bounds turn red.
+ */
+void indexedToArgb(const uint8_t *input, uint32_t *output, int count);
+
+/** Scalar reference implementation of \c indexedToArgb(). */
+void indexedToArgbScalar(const uint8_t *input, uint32_t *output, int count);
+
+/**
+ * Returns a bitmap of the non-zero Bytes in \a pixels, which all have to be
+ * in [0, 3].  Bit \c N stands for the \c N'th Byte in memory order.
+ */
+inline uint8_t opaqueBits(uint64_t pixels) {
+  uint64_t set = (pixels | (pixels >> 1)) & 0x0101010101010101ULL;
+  return static_cast<uint8_t>((set * 0x0102040810204080ULL) >> 56);
+}
+
+/**
+ * Line buffer of the sprite pixels in a scan line.
+ *
+ * Sprites are drawn in reverse OAM order, 8 pixels at a time, each opaque
+ * pixel replacing what was drawn before.  This leaves the front-most opaque
+ * sprite pixel at each position, which is then composited with the background
+ * through \c composite().
+ */
+class SpriteLine {
+public:
+  /** Width of the buffer.  Sprites may reach up to 7 pixels past the screen. */
+  static constexpr int SIZE = 256 + 8;
+
+  /** Clears the line buffer. */
+  void clear() { ::memset(this->m_pixels, 0, sizeof(this->m_pixels)); }
+
+  /**
+   * Draws the row \a slice at \a x, using the sprite palette \a palette.  If
+   * \a behind is \c true, the pixels are hidden behind opaque background.
+   */
+  void draw(int x, TileSlice slice, int palette, bool behind) {
+    uint64_t set = (slice.value | (slice.value >> 1)) & 0x0101010101010101ULL;
+    uint64_t mask = set * 0xFF;
+    uint64_t attributes = (palette << PALETTE_SHIFT) | (behind ? BEHIND : 0);
+    uint64_t pixels = slice.value | (set * attributes);
+
+    uint64_t line;
+    ::memcpy(&line, this->m_pixels + x, sizeof(line));
+    line = (line & ~mask) | pixels;
+    ::memcpy(this->m_pixels + x, &line, sizeof(line));
+  }
+
+  /**
+   * Draws the sprite pixels into \a output, starting at \a minPos, using
+   * \a palettes for colors.  Pixels behind the background are only drawn if
+   * their bit in the background opacity bitmap \a dots is not set.
+   */
+  void composite(uint8_t *output, const uint8_t *dots,
+                 const Palette *palettes, int minPos) const;
+
+private:
+  static constexpr uint8_t COLOR_MASK = 0x03;
+  static constexpr int PALETTE_SHIFT = 2;
+  static constexpr uint8_t BEHIND = 0x10;
+
+  alignas(8) uint8_t m_pixels[SIZE];
+};
+}
+}
+
+#endif // PPU_COMPOSITOR_HPP
@@ -2,6 +2,8 @@
 #define PPU_MEMORY_HPP
 
 #include <cartridge/base.hpp>
+#include <ppu/tilecache.hpp>
+#include <ppu/writelog.hpp>
 
 #include <ppu.hpp>
 
@@ -54,12 +56,27 @@ public:
   /** Object Attribute Memory, stores information of Sprites. */
   uint8_t oam[OAM_SIZE];
 
+  /**
+   * Generation of the OAM, incremented on every change to it.  Code writing
+   * into \c oam directly has to increment it too.
+   */
+  uint32_t oamGeneration = 0;
+
   /** Color palettes memory. */
   uint8_t palettes[PALETTES_SIZE];
 
   /** Memory for name tables. */
   uint8_t ram[MEMORY_SIZE];
 
+  /**
+   * Generation of the name table memory, incremented on every write into
+   * it.  Code writing into \c ram directly has to increment it too.
+   */
+  uint32_t nameTableGeneration = 0;
+
+  /** Decoded tiles of the pattern tables. */
+  TileCache tiles;
+
   /** Is rendering enabled? */
   bool isEnabled() const;
 
@@ -69,6 +86,16 @@ public:
   /** Resets the internal state. */
   void reset();
 
+  /** Writes the registers and memory into \a out. */
+  void saveState(Core::StateWriter &out) const;
+
+  /**
+   * Restores the registers and memory written by \c saveState() from \a in.
+   * The state of the cartridge has to be restored before, as the decoded
+   * tiles are dropped.
+   */
+  void loadState(Core::StateReader &in);
+
   /** Reads a byte at \a address.  This is only accessed from the CPU! */
   uint8_t cpuRead(int address);
 
@@ -89,15 +116,39 @@ public:
   /** Writes \a value into \a address. */
   void write(int address, uint8_t value);
 
+  /**
+   * Sets the \a log all writes into the name tables, palettes, CHR RAM and
+   * the OAM are appended to.  Pass \c nullptr to stop logging.
+   */
+  void setWriteLog(WriteLog *log);
+
+  /**
+   * Appends the current register state to the write log for drawing scan
+   * \a line, preceded by changes to the CHR mapping since the last entry.
+   */
+  void logScanLine(int line);
+
   /** Returns the cartridge mapper. */
   Cartridge::Base::Ptr cartridge() const
   { return this->m_cartridge; }
 
+  /** The currently active name table mirroring mode of the cartridge. */
+  Mirroring nameTableMirroring() const
+  { return this->m_cartridgePtr->nameTableMirroring(); }
+
 private:
   Cartridge::Base::Ptr m_cartridge;
   Cartridge::Base *m_cartridgePtr;
+  const uint8_t *const *m_pages;
+  uint8_t *const *m_writePages;
+  void logMapping();
+
+  WriteLog *m_log = nullptr;
+  const uint8_t *m_loggedPages[NAME_TABLE_BASE / PAGE_SIZE] = { }; ///< Logged CHR mapping
+  int m_loggedMirroring = -1; ///< Logged name table mirroring
+
   bool m_latch = false;
-  uint8_t m_buffer;
+  uint8_t m_buffer = 0;
 };
 }
 
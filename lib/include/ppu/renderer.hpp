@@ -18,8 +18,6 @@ struct RendererPrivate;
 class Renderer {
 public:
 
-  // TODO: Don't hardcode NTSC values.
-
   /** Width of a frame in pixels. */
   static constexpr int WIDTH = 256;
 
@@ -30,12 +28,59 @@ public:
   ~Renderer();
 
   /**
-   * Draws the next scanline.  Interacts with the given surface manager and the
-   * CPU core by itself.  Returns \c true if the current scan line was the last
-   * one in the current frame.
+   * Draws the scan line returned by \c nextScanLine(), catching up on the idle
+   * ones before it.  Interacts with the given surface manager and the CPU core
+   * by itself.  Returns \c true if the scan line was the last one in the
+   * current frame.
    */
   bool drawScanLine();
 
+  /**
+   * The next scan line \c drawScanLine() has to be called for, once the CPU
+   * reached its end.
+   */
+  int nextScanLine() const;
+
+  /**
+   * Sets the \a count of scan lines per frame, including the pre-render line.
+   * Defaults to the 262 scan lines of NTSC.  \sa Core::Timing
+   */
+  void setScanLineCount(int count);
+
+  /**
+   * If \c true, frames are emulated without being drawn, and not handed to
+   * the surface manager.  Everything observable by the CPU stays the same:
+   * VBlank and NMI timing, sprite overflow and the sprite 0 hit.  Should only
+   * be changed between frames.
+   */
+  bool skipRaster() const;
+  void setSkipRaster(bool skip);
+
+  /**
+   * If \c true, frames are drawn on a separate thread, while the CPU emulates
+   * the next frame.  The surface manager is given the newest frame the thread
+   * finished, which lags behind by a frame.  Everything observable by the CPU
+   * stays the same.  Should only be changed between frames.
+   */
+  bool isThreaded() const;
+  void setThreaded(bool threaded);
+
+  /**
+   * Makes the render thread pick up changes to the PPU memory which didn't go
+   * through the CPU, like a reset.  Does nothing if not threaded.
+   */
+  void synchronize();
+
+  /** Writes the current scan line into \a out.  Must be called between frames. */
+  void saveState(Core::StateWriter &out) const;
+
+  /**
+   * Restores the scan line written by \c saveState() from \a in, and then
+   * synchronizes with the restored PPU memory.  Must be called between frames,
+   * after the PPU memory was restored.
+   */
+  void loadState(Core::StateReader &in);
+
 private:
   RendererPrivate *d;
 };
@@ -10,10 +10,60 @@ namespace Ppu {
 class SurfaceManager {
 public:
 
+  /** Pixel formats of frames handed to the surface manager. */
+  enum FrameFormat {
+    /** 32-bit ARGB pixels, passed to \c displayFrameBuffer(). */
+    Argb32,
+
+    /**
+     * One Byte per pixel, being an index into \c Ppu::COLORS, passed to
+     * \c displayIndexedFrame().
+     */
+    Indexed
+  };
+
+  /**
+   * The format the renderer should hand frames in.  Defaults to \c Argb32.
+   * Front-ends which convert frames by themselves, or don't need colors at
+   * all, can use \c Indexed to skip the conversion in the renderer.
+   */
+  virtual FrameFormat frameFormat() const
+  { return Argb32; }
+
+  /**
+   * Returns the buffer the next frame is written into, in the \c frameFormat().
+   * It's handed back through \c presentFrame() once the frame is finished, and
+   * has to stay valid until then.  Front-ends can keep a pool of buffers this
+   * way, so frames don't have to be copied.
+   *
+   * Defaults to \c nullptr, in which case the renderer draws into its own
+   * buffer and hands it to \c displayFrameBuffer() or \c displayIndexedFrame()
+   * instead.
+   */
+  virtual void *acquireFrame()
+  { return nullptr; }
+
+  /**
+   * Displays the finished \a frame, as returned by \c acquireFrame() before.
+   * Is called on the emulation path, so it shouldn't wait for painting.
+   */
+  virtual void presentFrame(void *frame)
+  { (void)frame; }
+
+  /**
+   * Displays the data in \a buffer.  Only used if \c acquireFrame() returns
+   * \c nullptr.
+   */
+  virtual void displayFrameBuffer(uint32_t *buffer)
+  { (void)buffer; }
+
   /**
-   * Displays the data in \a buffer.
+   * Displays the indexed frame in \a buffer.  Only used if \c frameFormat()
+   * returns \c Indexed, and \c acquireFrame() returns \c nullptr.
+   * \sa Ppu::Compositor::indexedToArgb()
    */
-  virtual void displayFrameBuffer(uint32_t *buffer) = 0;
+  virtual void displayIndexedFrame(const uint8_t *buffer)
+  { (void)buffer; }
 };
 }
 
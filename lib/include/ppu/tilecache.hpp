@@ -0,0 +1,85 @@
+#ifndef PPU_TILECACHE_HPP
+#define PPU_TILECACHE_HPP
+
+#include <cartridge/base.hpp>
+
+#include <unordered_map>
+#include <memory>
+
+namespace Ppu {
+/** Horizontal slice of a tile, one 2-bit color index per pixel. */
+union TileSlice {
+  uint8_t row[8];
+  uint64_t value;
+};
+
+static_assert(sizeof(TileSlice) == sizeof(uint64_t), "TileSlice should be 8 byte wide");
+
+/**
+ * Cache of decoded pattern table tiles.
+ *
+ * Tiles are decoded once into \c TileSlice rows, both as is and flipped
+ * horizontally.  Decoded tiles are kept by the physical CHR memory they were
+ * decoded from, as returned by \c Cartridge::Base::chrPage(), so bank
+ * switches don't require decoding them again.
+ */
+class TileCache {
+public:
+  /** Size of a CHR page in bytes. */
+  static constexpr int PAGE_SIZE = 1024;
+
+  /** Count of CHR pages in the PPU address space. */
+  static constexpr int PAGE_COUNT = 0x2000 / PAGE_SIZE;
+
+  /** Count of tiles in a CHR page. */
+  static constexpr int TILES_PER_PAGE = PAGE_SIZE / 16;
+
+  TileCache(Cartridge::Base *cartridge);
+  ~TileCache();
+
+  /**
+   * Looks up the decoded pages for the currently mapped CHR banks.  Must be
+   * called before \c slice() after the CHR mapping may have changed.
+   */
+  void update();
+
+  /**
+   * Returns the \a y'th row of the \a index'th tile in the pattern table at
+   * \a base.  If \a flip is \c true, the row is flipped horizontally.
+   */
+  TileSlice slice(int base, int index, int y, bool flip = false) {
+    int address = base + index * 16;
+    Page *page = this->m_pages[address / PAGE_SIZE];
+    int tile = (address / 16) % TILES_PER_PAGE;
+
+    if (!(page->decoded & (uint64_t(1) << tile))) this->decode(page, tile);
+    return page->rows[tile][flip][y];
+  }
+
+  /** Drops the decoded tile at \a address, after the CHR RAM was written. */
+  void invalidate(int address);
+
+  /**
+   * Drops all tiles decoded from CHR RAM, after it was replaced as a whole.
+   * Tiles of CHR ROM can't have changed, and are kept.
+   */
+  void clear();
+
+private:
+  struct Page {
+    const uint8_t *source;
+    uint64_t decoded = 0; ///< Bitmap of decoded tiles
+    bool writable = false; ///< Has been mapped as CHR RAM
+    TileSlice rows[TILES_PER_PAGE][2][8]; ///< As-is and flipped rows by tile
+  };
+
+  Page *page(const uint8_t *source);
+  void decode(Page *page, int tile);
+
+  Cartridge::Base *m_cartridge;
+  Page *m_pages[PAGE_COUNT] = { };
+  std::unordered_map<const uint8_t *, std::unique_ptr<Page>> m_cache;
+};
+}
+
+#endif // PPU_TILECACHE_HPP
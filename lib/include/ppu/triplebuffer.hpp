@@ -0,0 +1,48 @@
+#ifndef PPU_TRIPLEBUFFER_HPP
+#define PPU_TRIPLEBUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace Ppu {
+/**
+ * Hands frames from a producing to a consuming thread, without either one
+ * waiting for the other.
+ *
+ * Of the three buffers, the producer draws into one, the consumer displays
+ * another, and the third holds the newest finished frame.  Finished frames
+ * not taken before the next one is finished are dropped.
+ */
+class TripleBuffer {
+public:
+  /** Allocates three buffers of \a size Bytes each. */
+  TripleBuffer(int size);
+  ~TripleBuffer();
+
+  /** The buffer to draw into.  Only used by the producer. */
+  uint8_t *back() const
+  { return this->m_buffers[this->m_back].get(); }
+
+  /** Exchanges the finished back buffer for a free one. */
+  void publish();
+
+  /**
+   * Takes the newest finished frame, which stays valid until the next call.
+   * Returns \c nullptr if no frame was finished since the last call.  Only
+   * used by the consumer.
+   */
+  const uint8_t *takeFront();
+
+private:
+  static constexpr int FRESH = 4; ///< Set in \c m_middle if not taken yet
+  static constexpr int INDEX_MASK = 3;
+
+  std::unique_ptr<uint8_t[]> m_buffers[3];
+  int m_back = 0; ///< Buffer of the producer
+  int m_front = 1; ///< Buffer of the consumer
+  std::atomic<int> m_middle{2}; ///< Newest finished buffer, and \c FRESH
+};
+}
+
+#endif // PPU_TRIPLEBUFFER_HPP
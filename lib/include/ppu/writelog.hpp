@@ -0,0 +1,121 @@
+#ifndef PPU_WRITELOG_HPP
+#define PPU_WRITELOG_HPP
+
+#include <ppu.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <memory>
+
+namespace Ppu {
+/**
+ * Log of the changes to the PPU state, in the order they happened, to replay
+ * them on another thread.
+ *
+ * The log is a lock-free ring buffer with a single writer and a single reader.
+ * Appended entries become visible to the reader once \c publish() is called.
+ * The \c ScanLine entries act as timestamps: All entries before one happened
+ * before that scan line was drawn.
+ */
+class WriteLog {
+public:
+  /** Count of entries the log can hold. */
+  static constexpr uint32_t CAPACITY = 1 << 16;
+
+  /** Types of log entries. */
+  enum Type : uint8_t {
+    MemoryWrite, ///< \c value was written to \c address in the PPU address space
+    OamWrite, ///< \c value was written to \c address in the OAM
+    ChrPage, ///< The CHR page \c address now maps to \c page
+    NameTableMirroring, ///< The name table mirroring changed to \c value
+    ScanLine, ///< Scan line \c address is drawn using \c registers
+    FrameEnd, ///< All scan lines of the frame have been logged
+  };
+
+  /** Register state of a \c ScanLine entry. */
+  struct Registers {
+    uint8_t control;
+    uint8_t mask;
+    uint16_t scrollX;
+    uint16_t scrollY;
+  };
+
+  struct Entry {
+    Type type;
+    uint8_t value;
+    uint16_t address;
+
+    union {
+      const uint8_t *page;
+      Registers registers;
+    };
+
+    Entry() = default;
+    Entry(Type t, int a, uint8_t v = 0)
+      : type(t), value(v), address(static_cast<uint16_t>(a)), page(nullptr)
+    { }
+  };
+
+  WriteLog();
+  ~WriteLog();
+
+  /** Appends \a entry.  If the log is full, waits for the reader. */
+  void append(const Entry &entry) {
+    if (this->m_head - this->m_writerTail >= CAPACITY) this->waitForSpace();
+
+    this->m_entries[this->m_head % CAPACITY] = entry;
+    this->m_head++;
+  }
+
+  /** Makes all appended entries visible to the reader, and wakes it up. */
+  void publish();
+
+  /**
+   * Waits until the reader is done with all entries appended so far, and is
+   * waiting for more.
+   */
+  void drain();
+
+  /**
+   * Takes the next entry into \a entry, waiting until one was published.
+   * Returns \c false if the log was closed instead.  Only called by the reader.
+   */
+  bool take(Entry &entry) {
+    if (this->m_tail == this->m_readerHead && !this->refill()) return false;
+
+    entry = this->m_entries[this->m_tail % CAPACITY];
+    this->m_tail++;
+    return true;
+  }
+
+  /** Closes the log, making the reader return from \c take(). */
+  void close();
+
+private:
+  void waitForSpace();
+  bool refill();
+
+  std::unique_ptr<Entry[]> m_entries;
+
+  // Writer side
+  uint32_t m_head = 0; ///< Next entry to write
+  uint32_t m_writerTail = 0; ///< Last known tail of the reader
+
+  // Reader side
+  alignas(64) uint32_t m_tail = 0; ///< Next entry to read
+  uint32_t m_readerHead = 0; ///< Last known published head
+
+  // Shared
+  alignas(64) std::atomic<uint32_t> m_published{0};
+  alignas(64) std::atomic<uint32_t> m_consumed{0};
+  std::mutex m_mutex;
+  std::condition_variable m_wakeReader;
+  std::condition_variable m_wakeWriter;
+  bool m_closed = false;
+};
+
+static_assert(sizeof(WriteLog::Entry) == 16, "WriteLog::Entry should be 16 bytes wide");
+}
+
+#endif // PPU_WRITELOG_HPP
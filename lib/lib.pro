@@ -7,12 +7,15 @@ include(../common.pri)
 
 ###
 SOURCES += \
+  src/core/batch.cpp \
   src/core/configuration.cpp \
   src/core/data.cpp \
   src/core/disassembler.cpp \
   src/core/inesfile.cpp \
   src/core/instruction.cpp \
+  src/core/rewindbuffer.cpp \
   src/core/runner.cpp \
+  src/core/scheduler.cpp \
   src/core/gamepad.cpp \
   src/cpu/base.cpp \
   src/cpu/dumphook.cpp \
@@ -22,20 +25,28 @@ SOURCES += \
   src/cartridge/base.cpp \
   src/cartridge/nrom.cpp \
   src/cartridge/mmc1.cpp \
+  src/cartridge/shadow.cpp \
+  src/ppu/compositor.cpp \
   src/ppu/memory.cpp \
   src/ppu/renderer.cpp \
+  src/ppu/tilecache.cpp \
+  src/ppu/triplebuffer.cpp \
+  src/ppu/writelog.cpp \
   src/analysis/function.cpp \
-  src/analysis/branch.cpp \
-  src/analysis/functiondisassembler.cpp \
-  src/analysis/conditionalinstruction.cpp
+  src/analysis/functiondisassembler.cpp
 
 HEADERS += \
+  include/core/batch.hpp \
   include/core/configuration.hpp \
   include/core/data.hpp \
   include/core/disassembler.hpp \
   include/core/inesfile.hpp \
   include/core/instruction.hpp \
+  include/core/rewindbuffer.hpp \
   include/core/runner.hpp \
+  include/core/savestate.hpp \
+  include/core/scheduler.hpp \
+  include/core/timing.hpp \
   include/core/gamepad.hpp \
   include/cpu/base.hpp \
   include/cpu/dumphook.hpp \
@@ -46,20 +57,32 @@ HEADERS += \
   include/cartridge/base.hpp \
   include/cartridge/nrom.hpp \
   include/cartridge/mmc1.hpp \
+  include/cartridge/shadow.hpp \
   include/ppu/surfacemanager.hpp \
+  include/ppu/compositor.hpp \
   include/ppu/memory.hpp \
   include/ppu/renderer.hpp \
+  include/ppu/tilecache.hpp \
+  include/ppu/triplebuffer.hpp \
+  include/ppu/writelog.hpp \
   include/ppu.hpp \
   include/analysis/function.hpp \
-  include/analysis/branch.hpp \
   include/analysis/functiondisassembler.hpp \
-  include/analysis/conditionalinstruction.hpp \
   include/analysis/repository.hpp
 
 ### Interpret
 
-HEADERS += include/interpret/core_interpret.hpp
-SOURCES += src/interpret/core.cpp
+HEADERS += \
+  include/interpret/core_interpret.hpp \
+  include/interpret/core_threaded.hpp \
+  include/interpret/hookpolicy.hpp \
+  include/interpret/lazyflags.hpp \
+  include/interpret/lockstep.hpp
+
+SOURCES += \
+  src/interpret/core.cpp \
+  src/interpret/lockstep.cpp \
+  src/interpret/threaded.cpp
 
 ### Dynarec/LLVM
 
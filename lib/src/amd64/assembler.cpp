@@ -1,17 +1,68 @@
 #include <amd64/assembler.hpp>
 
+#include <algorithm>
+#include <mutex>
 #include <stdexcept>
 
 namespace Amd64 {
+namespace {
+/** Names of the interned symbols.  Shared by all assemblers. */
+struct SymbolTable {
+  std::mutex mutex;
+  std::unordered_map<std::string, uint32_t> labels;
+  std::vector<std::string> names;
+};
+
+SymbolTable &symbolTable() {
+  static SymbolTable table;
+  return table;
+}
+}
+
+Label Label::symbol(const std::string &name) {
+  SymbolTable &table = symbolTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  auto it = table.labels.find(name);
+  if (it != table.labels.end()) return Label(it->second);
+
+  uint32_t id = SYMBOL | static_cast<uint32_t>(table.names.size());
+  table.labels.emplace(name, id);
+  table.names.push_back(name);
+  return Label(id);
+}
+
+std::string Label::name() const {
+  if (!this->isSymbol()) return "block_" + std::to_string(this->id);
+
+  SymbolTable &table = symbolTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return table.names.at(this->id & ~SYMBOL);
+}
+
 Assembler::Assembler() {
 }
 
-Section &Assembler::section(const std::string &name) {
-  if (this->m_sections.find(name) == this->m_sections.end()) {
-    this->m_sections.emplace(name, Section(name));
+Section &Assembler::begin(Label label, bool cold) {
+  if (!this->m_index.emplace(label.id, static_cast<int>(this->m_blocks.size())).second) {
+    throw std::runtime_error("Duplicate block " + label.name());
   }
 
-  return this->m_sections.at(name);
+  size_t offset = this->m_code.size();
+  if (!this->m_blocks.empty()) this->m_blocks.back().end = offset;
+  this->m_blocks.push_back(Block{ label, offset, offset, cold });
+  return this->m_code;
+}
+
+int Assembler::indexOf(Label label) const {
+  auto it = this->m_index.find(label.id);
+  return (it != this->m_index.end()) ? it->second : -1;
+}
+
+std::vector<Assembler::Block> Assembler::blocks() const {
+  std::vector<Block> result(this->m_blocks);
+  if (!result.empty()) result.back().end = this->m_code.size();
+  return result;
 }
 
 template<typename T>
@@ -124,19 +175,24 @@ static void checkRexAndHigh8BitRegisters(Register first, Register second) {
   }
 }
 
-void Section::append(const Section &other) {
+void Section::append(const Section &other, size_t begin, size_t length) {
   uintptr_t offset = this->bytes.size(); // New base offset of the added section body.
+  auto first = other.bytes.begin() + static_cast<intptr_t>(begin);
+
+  this->bytes.insert(this->bytes.end(), first, first + static_cast<intptr_t>(length));
 
-  this->bytes.insert(this->bytes.end(), other.bytes.begin(), other.bytes.end());
+  // Append and adjust references.  These are ordered by offset.
+  auto it = std::lower_bound(other.references.begin(), other.references.end(), begin,
+                             [](const Reference &ref, size_t off){ return ref.offset < off; });
+
+  for (; it != other.references.end() && it->offset < begin + length; ++it) {
+    Reference ref = *it;
 
-  // Append and adjust references
-  this->references.reserve(this->references.size() + other.references.size());
-  for (Reference ref : other.references) {
     if (ref.base > 0) { // Adjust relative addresses
-      ref.base += offset;
+      ref.base = ref.base - begin + offset;
     }
 
-    ref.offset += offset;
+    ref.offset = ref.offset - begin + offset;
     this->references.push_back(ref);
   }
 }
@@ -362,6 +418,7 @@ void Section::emitJcc(Condition cond, const MemReg &destination) {
   this->emitJccPrefix(cond, 32);
   this->append(uint32_t(0));
   this->addRipRef(destination, -4, sizeof(uint32_t));
+  this->references.back().jump = true;
 }
 
 static uint8_t jmpNearRegMemOpcode(int bits) {
@@ -382,6 +439,7 @@ void Section::emitJmp(const MemReg &destination) {
   } else {
     this->append(JMP_Near_rel32off, uint32_t(0));
     this->addRipRef(destination, -4, sizeof(uint32_t));
+    this->references.back().jump = true;
   }
 }
 
@@ -455,6 +513,30 @@ void Section::emitMov(const MemReg &source, Register destination) {
   }
 }
 
+void Section::emitNop(size_t count) {
+  // The recommended multi-byte NOP sequences, indexed by their length.
+  static const Stream NOPS[] = {
+    { },
+    { 0x90 },
+    { 0x66, 0x90 },
+    { 0x0F, 0x1F, 0x00 },
+    { 0x0F, 0x1F, 0x40, 0x00 },
+    { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+    { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+    { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
+    { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+  };
+
+  static constexpr size_t LONGEST = sizeof(NOPS) / sizeof(*NOPS) - 1;
+
+  while (count > 0) {
+    size_t len = (count > LONGEST) ? LONGEST : count;
+    this->append(NOPS[len]);
+    count -= len;
+  }
+}
+
 void Section::emitMovzx(Register source, Register destination) {
   int srcBits = registerBits(source);
   int dstBits = registerBits(destination);
@@ -768,7 +850,7 @@ void Section::emitSuffix(const MemReg &memory, Register reg, uint8_t group) {
   int dispBits = 0;
   uint8_t mod = MOD_MEM;
   uint8_t rm = (memory.index == NoRegister) ? RIP_RELATIVE : HAS_SIB_BYTE;
-  uint8_t regNo = registerIndex(reg);
+  uint8_t regNo = (reg == NoRegister) ? group : registerIndex(reg);
   bool needsReference = false;
 
   if (memory.displacement != 0) { // MOV 0x1234, %rax
@@ -779,7 +861,7 @@ void Section::emitSuffix(const MemReg &memory, Register reg, uint8_t group) {
     } else {
       mod = MOD_MEM_DISP8;
     }
-  } else if (!memory.name.empty()) { // MOV helloStr, %rax
+  } else if (memory.label.isValid()) { // MOV helloStr, %rax
     dispBits = 32;
     mod = MOD_MEM_DISP32;
     needsReference = true;
@@ -787,7 +869,6 @@ void Section::emitSuffix(const MemReg &memory, Register reg, uint8_t group) {
     throw std::invalid_argument("No displacement and no base register given");
   } else if (memory.index == NoRegister) {
     rm = registerIndex(memory.base);
-    regNo = group;
   } else if (memory.index != NoRegister) { // Base+Index is set without a displacement
     mod = MOD_MEM_DISP8; // Use a 8-Bit zero displacement
     dispBits = 8;
@@ -827,16 +908,6 @@ void Section::emitXor(uint32_t immediate, Register destination) {
   genericImmToReg<uint32_t, XOR_RegMem8_imm8, XOR_RegMem16_imm16, 6>(this, immediate, destination);
 }
 
-MemReg::MemReg(const Section &disp, Register base, Register index, uint8_t scale)
-  : MemReg(disp.name, true, 0, base, index, scale)
-{
-  //
-}
-
-MemReg MemReg::value(const Section &symbol) {
-  return MemReg(symbol.name, false, 0, NoRegister, NoRegister, 1);
-}
-
 void MemReg::throwIfValue() const {
   if (!this->dereference) {
     throw std::invalid_argument("Mem/Reg reference must dereferenced for this instruction");
@@ -74,6 +74,7 @@ struct CoreImpl {
     this->symbols.add("Ram", mem->ram());
     this->symbols.add("Stack", mem->ram() + Cpu::STACK_BASE);
     this->symbols.add("State", &s);
+    this->symbols.add("Interrupts", &s.interrupts);
     this->symbols.add("read", reinterpret_cast<void *>(&memRead));
     this->symbols.add("read16", reinterpret_cast<void *>(&memRead16));
     this->symbols.add("write", reinterpret_cast<void *>(&memWrite));
@@ -87,8 +88,8 @@ struct CoreImpl {
   Function *compileAnalyzed(Analysis::Function &base) {
     FunctionTranslator t;
 
-    for (const Analysis::Branch *branch : base.branches())
-      t.addBranch(*branch);
+    for (const Analysis::Function::Branch &branch : base.branches())
+      t.addBranch(base, branch);
 
     void *execPtr = t.link(base.begin(), this->symbols, this->memory);
     return new Function(base, this->memory, execPtr);
@@ -97,12 +98,15 @@ struct CoreImpl {
   void run(Cpu::State &state) {
     using Cpu::State;
 
+    // Take interrupts right here, so we go straight on to the handler.
+    if (state.interrupts) this->core->servicePending();
+
     bool running = true;
     while (running && state.cycles > 0) {
       Function *func = this->repository.get(state.pc);
       func->call(state);
 
-      if (!func->analyzed().cacheable()) delete func;
+      if (!func->info().cacheable) delete func;
 
       switch (state.reason) {
       case State::Reason::Break:
@@ -123,6 +127,11 @@ struct CoreImpl {
         state.cycles = 0;
         running = false;
         break;
+      case State::Reason::Interrupt:
+        // The guest code noticed a pending interrupt, and already updated the
+        // state.pc to resume at.
+        this->core->servicePending();
+        break;
       case State::Reason::UnknownInstruction:
         throw std::runtime_error("Unknown 6502 instruction encountered");
       }
@@ -80,6 +80,9 @@ intptr_t ExecutableMemory::allocate(size_t len) {
   // Naive best-fit algorithm: Finds the first free large-enough frame, and
   // a free frame that is the smallest yet still fitting one.
 
+  // Frames are only ever split at multiples of the alignment.
+  len = (len + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
   auto it = this->m_frames.begin(), end = this->m_frames.end();
   auto first = end, best = end;
   size_t bestSize = std::numeric_limits<size_t>::max();
@@ -3,7 +3,7 @@
 
 namespace Amd64 {
 Function::Function(const Analysis::Function &analyzed, MemoryManager &manager, void *funcPtr)
-  : m_analyzed(analyzed), m_manager(manager), m_funcPtr(funcPtr)
+  : m_info(analyzed.info()), m_manager(manager), m_funcPtr(funcPtr)
 {
 
 }
@@ -15,31 +15,25 @@ namespace Amd64 {
 FunctionTranslator::FunctionTranslator() {
 }
 
-static std::string instructionSectionName(uint16_t address) {
-  return "instr_" + std::to_string(address);
-}
-
-void FunctionTranslator::addBranch(const Analysis::Branch &branch) {
-  for (const Analysis::Branch::Element &el : branch.elements()) {
-    uint16_t address = el.first;
-    Analysis::Branch::Instruction instr = el.second;
-
-    if (this->m_sections.find(address) == this->m_sections.end()) {
-      Section &section = this->m_asm.section(instructionSectionName(address));
-      InstructionTranslator t(section);
+void FunctionTranslator::addBranch(const Analysis::Function &func, const Analysis::Function::Branch &branch) {
+  for (size_t i = branch.begin; i < branch.end; i++) {
+    uint16_t address = func.address(i);
+    Label label = InstructionTranslator::label(address);
 
-      this->m_sections.insert({ address, section });
-      auto jump = t.translate(address, instr);
+    if (!this->m_asm.has(label)) {
+      Section &code = this->m_asm.begin(label);
+      InstructionTranslator t(this->m_asm);
+      auto jump = t.translate(func, i);
 
       if (jump.first) { // Need to add a JMP?
-        section.emitJmp(instructionSectionName(jump.second));
+        code.emitJmp(InstructionTranslator::label(jump.second));
       }
     }
   }
 }
 
 void *FunctionTranslator::link(uint16_t entry, SymbolRegistry &symbols, MemoryManager &memory) {
-  Linker linker(instructionSectionName(entry), symbols, memory);
+  Linker linker(InstructionTranslator::label(entry), symbols, memory);
   linker.add(this->m_asm);
   return linker.link(DUMP_DISASSEMBLY);
 }
@@ -24,8 +24,10 @@
 /*************************                           **************************/
 
 namespace Amd64 {
-InstructionTranslator::InstructionTranslator(Section &section)
-  : m_sec(section)
+static const MemReg INTERRUPTS_PTR = MemReg::value("Interrupts");
+
+InstructionTranslator::InstructionTranslator(Assembler &assembler)
+  : m_asm(assembler), m_sec(assembler.code())
 {
 
 }
@@ -68,21 +70,21 @@ void InstructionTranslator::logInstruction(uint16_t address, Core::Instruction i
 #endif
 }
 
-std::pair<bool, uint16_t> InstructionTranslator::translate(uint16_t address, const Analysis::Branch::Instruction &instr) {
-  if (const Core::Instruction *ptr = std::get_if<Core::Instruction>(&instr)) {
-    auto result = this->translate(address, *ptr);
-    if (result.first) this->logInstruction(address, *ptr);
-    return result;
-  } else {
-    this->translate(address, std::get<Analysis::ConditionalInstruction>(instr));
+std::pair<bool, uint16_t> InstructionTranslator::translate(const Analysis::Function &func, size_t index) {
+  uint16_t address = func.address(index);
+  Core::Instruction instr = func.instruction(index);
+
+  if (instr.isConditionalBranching()) {
+    uint16_t nextAddr = static_cast<uint16_t>(address + instr.operandSize() + 1);
+    this->translate(address, instr, instr.destinationAddress(nextAddr), nextAddr);
     return { false, 0 };
+  } else {
+    auto result = this->translate(address, instr);
+    if (result.first) this->logInstruction(address, instr);
+    return result;
   }
 }
 
-static std::string branchSectionName(const Analysis::Branch *branch) {
-  return "instr_" + std::to_string(branch->start());
-}
-
 static std::pair<Cpu::Flag, bool> branchCommandToFlag(Core::Instruction::Command command) {
   using Core::Instruction;
 
@@ -100,33 +102,41 @@ static std::pair<Cpu::Flag, bool> branchCommandToFlag(Core::Instruction::Command
   }
 }
 
-void InstructionTranslator::translate(uint16_t address, Analysis::ConditionalInstruction instr) {
+void InstructionTranslator::translate(uint16_t address, ::Core::Instruction instr, uint16_t truthy, uint16_t falsy) {
   using Core::Instruction;
 
   auto branchFlag = branchCommandToFlag(instr.command);
-  std::string truthy = branchSectionName(instr.trueBranch());
-  std::string falsy = branchSectionName(instr.falseBranch());
+  Label exit = label(address, ExitBlock);
 
   this->traceInstruction(address, instr);
   Condition cond = (branchFlag.second) ? Carry : NotCarry;
 
-  // Cycle-exhaustion check:
-  this->m_sec.emitMov(static_cast<uint8_t>(Cpu::State::Reason::CyclesExhausted), REASON);
-  this->m_sec.emitMov(address, PC);
+  // Cycle-exhaustion check.  Exiting is the rare case, so the exit itself is
+  // kept in a cold block.
   this->m_sec.emitCmp(CYCLES, 0);
-  this->m_sec.emitJcc(GreaterOrEqual, 1);
-  this->m_sec.emitRet(); //           ^ Skipped by this
-
-  // Late-count cycles, so the check above doesn't take the cycles of this
-  // instruction into account.  Else when we resume after exhaustion this
-  // instruction would be counted twice.
-  this->countCycles(instr.cycles);
+  this->m_sec.emitJcc(Less, exit);
+
+  // Performs the actual conditional branch.  Cycles are late-counted, so the
+  // check above doesn't take the cycles of this instruction into account.
+  // Else when we resume after exhaustion this instruction would be counted
+  // twice.
+  auto branch = [&]() {
+    this->m_sec.emitSub(instr.cycles, CYCLES);
+    this->m_sec.emitBt(static_cast<uint8_t>(Cpu::flagBit(branchFlag.first)), PX);
+    this->m_sec.emitJcc(cond, label(truthy));
+    this->m_sec.emitJmp(label(falsy));
+  };
+
+  this->pollInterrupts(label(address, InterruptBlock));
   this->logInstruction(address, instr);
+  branch();
+
+  this->m_asm.begin(exit, true);
+  this->m_sec.emitMov(static_cast<uint8_t>(Cpu::State::Reason::CyclesExhausted), REASON);
+  this->m_sec.emitMov(address, PC);
+  this->m_sec.emitRet();
 
-  // Perform the actual conditional branch:
-  this->m_sec.emitBt(static_cast<uint8_t>(Cpu::flagBit(branchFlag.first)), PX);
-  this->m_sec.emitJcc(cond, truthy);
-  this->m_sec.emitJmp(falsy);
+  this->takeInterrupts(address, branch);
 }
 
 std::pair<bool, uint16_t> InstructionTranslator::translate(uint16_t address, ::Core::Instruction instr) {
@@ -433,6 +443,37 @@ void InstructionTranslator::adc(Register value) {
   this->m_sec.emitOr(VL, P);           // %P |= Overflow
 }
 
+void InstructionTranslator::pollInterrupts(Label take) {
+  this->m_sec.emitMov(INTERRUPTS_PTR, ADDRR);           // %WL = Pending lines
+  this->m_sec.emitMov(MemReg(ADDRR), WL);
+  this->m_sec.emitTest(WL, WL);
+  this->m_sec.emitJcc(NotZero, take);
+}
+
+void InstructionTranslator::takeInterrupts(uint16_t address, std::function<void()> resume) {
+  // The host takes the interrupt, and then continues at the handler.
+  uint8_t irqLine = static_cast<uint8_t>(1 << Cpu::Service);
+  uint8_t iFlag = static_cast<uint8_t>(Cpu::Flag::Interrupt);
+
+  Section exit;
+  exit.emitMov(static_cast<uint8_t>(Cpu::State::Reason::Interrupt), REASON);
+  exit.emitMov(address, PC);
+  exit.emitRet();
+
+  // Only reached if anything is pending at all.  Checks if the pending lines
+  // are all masked, in which case it resumes with the instruction.
+  this->m_asm.begin(label(address, InterruptBlock), true);
+  this->m_sec.emitMov(P, VL);                           // %VL = I flag ..
+  this->m_sec.emitAnd(iFlag, VL);
+  this->m_sec.emitShl(static_cast<uint8_t>(Cpu::Service - Cpu::flagBit(Cpu::Flag::Interrupt)), VL);
+  this->m_sec.emitXor(irqLine, VL);                     // .. as mask of the IRQ line
+  this->m_sec.emitOr(uint8_t(~irqLine), VL);            // Other lines are unmaskable
+  this->m_sec.emitAnd(VL, WL);
+  this->m_sec.emitJcc(Zero, static_cast<int32_t>(exit.size()));
+  this->m_sec.append(exit);
+  resume();
+}
+
 void InstructionTranslator::countCycles(int cycles) {
   // SUB $Count, %Cycles   ; Simply substract the cycle count
   this->m_sec.emitSub(cycles, CYCLES);
@@ -2,27 +2,20 @@
 #include <amd64/symbolregistry.hpp>
 #include <amd64/memorymanager.hpp>
 
+#include <algorithm>
 #include <limits>
 #include <cstdio>
 #include <sys/wait.h>
 
 namespace Amd64 {
-Linker::Linker(const std::string &entryPoint, SymbolRegistry &registry, MemoryManager &memory)
+Linker::Linker(Label entryPoint, SymbolRegistry &registry, MemoryManager &memory)
   : m_entryPoint(entryPoint), m_registry(registry), m_memory(memory)
 {
 
 }
 
-void Linker::add(const std::string &name, const Section &section) {
-  this->m_sections.insert({ name, section });
-}
-
 void Linker::add(const Assembler &assembler) {
-  const auto &sections = assembler.sections();
-
-  for (const auto &kv : sections) {
-    this->m_sections.insert(kv);
-  }
+  this->m_assembler = &assembler;
 }
 
 template<typename T>
@@ -55,12 +48,12 @@ static void fixUpSectionReference(uint8_t *data, uintptr_t rip, uintptr_t destin
   replaceBytes(ptr, ref.size, relative);
 }
 
-static void fixUpSymbolReference(uint8_t *data, uintptr_t rip, Symbol &symbol, const Reference &ref) {
+static void fixUpSymbolReference(uint8_t *data, uintptr_t rip, const Symbol &symbol, const Reference &ref) {
   uint8_t *ptr = data + ref.offset;
 
   uint64_t value = symbol.value;
   if (!symbol.isPointer && ref.base > 0) {
-    throw std::runtime_error("Symbol " + ref.name + " was referenced as pointer, but is not a pointer");
+    throw std::runtime_error("Symbol " + ref.label.name() + " was referenced as pointer, but is not a pointer");
   }
 
   uintptr_t relative = (ref.base > 0) ? value - rip : value;
@@ -88,7 +81,7 @@ static void debugDump(uint8_t *bytes, size_t length) {
 void *Linker::link(bool dumpDisassembly) {
   auto sectionOffsets = this->mergeSections();
   Section main(std::move(sectionOffsets.first));
-  std::map<std::string, uintptr_t> offsets(std::move(sectionOffsets.second));
+  std::vector<uintptr_t> offsets(std::move(sectionOffsets.second));
 
   // Load the merged section into (later) executable memory.  In the lambda
   // we'll then resolve the references through symbol lookups.
@@ -97,17 +90,16 @@ void *Linker::link(bool dumpDisassembly) {
     for (const Reference &ref : main.references) {
       uintptr_t rip = base + ref.base; // Base address for relative addressing
 
-      auto offsetIt = offsets.find(ref.name);
-      if (offsetIt != offsets.end()) {
-        // Is this a reference to another section?
-        fixUpSectionReference(data, rip, base + offsetIt->second, ref);
-      } else if (this->m_registry.has(ref.name)) {
+      int index = ref.label.isSymbol() ? -1 : this->m_assembler->indexOf(ref.label);
+      if (index >= 0) {
+        // Is this a reference to another block?
+        fixUpSectionReference(data, rip, base + offsets[static_cast<size_t>(index)], ref);
+      } else if (const Symbol *sym = this->m_registry.find(ref.label)) {
         // Is this a reference to a symbol?
-        Symbol sym = this->m_registry.get(ref.name);
-        fixUpSymbolReference(data, rip, sym, ref);
+        fixUpSymbolReference(data, rip, *sym, ref);
       } else {
         // Not found!
-        throw std::runtime_error("Can't resolve symbol: " + ref.name);
+        throw std::runtime_error("Can't resolve symbol: " + ref.label.name());
       }
 
     }
@@ -116,35 +108,258 @@ void *Linker::link(bool dumpDisassembly) {
   });
 }
 
-std::pair<Section, std::map<std::string, uintptr_t>> Linker::mergeSections() {
-  std::map<std::string, uintptr_t> offsets { { this->m_entryPoint, 0 } };
-  Section main(this->m_entryPoint);
+namespace {
+/** A jump at the end of a block.  These are re-encoded while merging. */
+struct TailJump {
+  enum Encoding { Dropped, Short, Long };
+
+  int target; ///< Index of the target block.
+  bool conditional;
+  Condition condition;
+  Encoding encoding = Short;
+
+  size_t size() const {
+    switch (this->encoding) {
+    case Dropped: return 0;
+    case Short: return 2; // JMP/Jcc rel8
+    case Long: return this->conditional ? 6 : 5; // Jcc/JMP rel32
+    }
+
+    return 0;
+  }
+};
+
+/** Layout information of an \c Assembler::Block. */
+struct Block {
+  Assembler::Block block;
+  size_t firstRef = 0; ///< References of the block in the assembler code.
+  size_t lastRef = 0;
+  size_t bodySize = 0; ///< Size of the block without the tail jumps.
+  std::vector<TailJump> jumps;
+  bool placed = false;
+  size_t index = 0; ///< Position in the hot part of the layout.
+  bool loopHeader = false;
+  size_t padding = 0;
+  uintptr_t offset = 0;
+};
+}
+
+/** Loop headers are aligned to this, if it doesn't need too much padding. */
+static constexpr size_t LOOP_ALIGNMENT = 16;
+static constexpr size_t MAX_LOOP_PADDING = 10;
+
+/** Inverts the condition \a cond, e.g. `Carry` becomes `NotCarry`. */
+static Condition invertCondition(Condition cond) {
+  return static_cast<Condition>(cond ^ 1);
+}
+
+/**
+ * Splits the jumps off the end of \a block in \a code into its \c jumps, and
+ * returns the size of the rest of the block.  Only jumps to other blocks of the
+ * \a assembler are considered.
+ */
+static size_t splitTailJumps(const Assembler &assembler, const Section &code, Block &block) {
+  size_t end = block.block.end;
+
+  for (size_t i = block.lastRef; i > block.firstRef; i--) {
+    const Reference &ref = code.references[i - 1];
+    int target = ref.label.isSymbol() ? -1 : assembler.indexOf(ref.label);
+
+    if (!ref.jump || ref.base != end || target < 0)
+      break;
+
+    uint8_t opcode = code.bytes.at(ref.offset - 1);
+    bool conditional = (opcode != JMP_Near_rel32off); // Else `0x0F 0x8?`
+    Condition cond = static_cast<Condition>(opcode & 0x0F);
+
+    block.jumps.insert(block.jumps.begin(), TailJump{ target, conditional, cond });
+    end = ref.offset - (conditional ? 2 : 1);
+  }
+
+  return end - block.block.begin;
+}
+
+std::pair<Section, std::vector<uintptr_t>> Linker::mergeSections() {
+  if (!this->m_assembler) {
+    throw std::runtime_error("No assembler to link");
+  }
+
+  const Assembler &assembler = *this->m_assembler;
+  const Section &code = assembler.code();
+  std::vector<Block> blocks;
+  std::vector<Block *> hot, cold;
 
-  // Reserve memory to speed up the process
-  size_t references = 0;
-  size_t totalBodySize = 0;
+  // Blocks are laid out back-to-back in the code, and so are their references.
+  size_t refIndex = 0;
+  for (const Assembler::Block &asmBlock : assembler.blocks()) {
+    Block block;
+    block.block = asmBlock;
 
-  for (const auto &kv : this->m_sections) {
-    references += kv.second.references.size();
-    totalBodySize += kv.second.bytes.size();
+    while (refIndex < code.references.size() && code.references[refIndex].offset < asmBlock.begin) refIndex++;
+    block.firstRef = refIndex;
+    while (refIndex < code.references.size() && code.references[refIndex].offset < asmBlock.end) refIndex++;
+    block.lastRef = refIndex;
+
+    blocks.push_back(block);
   }
 
-  main.bytes.reserve(totalBodySize);
-  main.references.reserve(references);
+  for (Block &block : blocks) {
+    block.bodySize = splitTailJumps(assembler, code, block);
+  }
 
-  // Add the entry section first!
-  auto entryIt = this->m_sections.find(this->m_entryPoint);
-  if (entryIt == this->m_sections.end()) {
-    throw std::runtime_error("Couldn't find entry-point section " + this->m_entryPoint);
+  int entry = assembler.indexOf(this->m_entryPoint);
+  if (entry < 0) {
+    throw std::runtime_error("Couldn't find entry-point block " + this->m_entryPoint.name());
   }
 
-  main.append(entryIt->second);
+  // Calls `func` with the index of the block targeted by each jump in `block`.
+  auto forEachJump = [&code, &assembler](const Block &block, auto func) {
+    for (size_t i = block.firstRef; i < block.lastRef; i++) {
+      const Reference &ref = code.references[i];
+      if (!ref.jump || ref.label.isSymbol()) continue;
+
+      int target = assembler.indexOf(ref.label);
+      if (target >= 0) func(target);
+    }
+  };
+
+  // Order the blocks along the control flow, starting at the entry point.
+  // Each chain follows the unconditional jumps, so they can be dropped later
+  // on.  All other jump targets are queued to start chains of their own.
+  // Cold blocks are collected on the way, and are put at the end.
+  std::vector<int> queue{ entry };
 
-  // Append all other sections
-  for (const auto &kv : this->m_sections) {
-    if (kv.first != this->m_entryPoint) {
-      offsets.insert({ kv.first, main.bytes.size() });
-      main.append(kv.second);
+  while (!queue.empty()) {
+    int index = queue.back();
+    queue.pop_back();
+
+    while (index >= 0) {
+      Block &block = blocks[static_cast<size_t>(index)];
+      if (block.placed) break;
+
+      block.placed = true;
+      index = -1;
+
+      if (block.block.cold) {
+        cold.push_back(&block);
+        continue;
+      }
+
+      block.index = hot.size();
+      hot.push_back(&block);
+      size_t queued = queue.size();
+      forEachJump(block, [&queue](int target){ queue.push_back(target); });
+
+      if (!block.jumps.empty() && !block.jumps.back().conditional) {
+        index = block.jumps.back().target; // Continue the chain here ..
+        queue.pop_back(); // .. instead of queueing it.
+      }
+
+      std::reverse(queue.begin() + static_cast<intptr_t>(queued), queue.end());
+    }
+  }
+
+  // Blocks not reachable through jumps.  Keep them for references.
+  for (Block &block : blocks) {
+    if (block.placed) continue;
+    block.index = hot.size();
+    hot.push_back(&block);
+  }
+
+  std::vector<Block *> layout(hot);
+  layout.insert(layout.end(), cold.begin(), cold.end());
+
+  // Find loop headers, which are the targets of backward jumps.  Also drop
+  // jumps to the following block, inverting conditional jumps if that
+  // allows to get rid of the unconditional jump after it.
+  for (size_t i = 0; i < hot.size(); i++) {
+    Block *block = hot[i];
+    Block *next = (i + 1 < layout.size()) ? layout[i + 1] : nullptr;
+    std::vector<TailJump> &jumps = block->jumps;
+
+    forEachJump(*block, [&blocks, i](int target){
+      Block &header = blocks[static_cast<size_t>(target)];
+      if (!header.block.cold && header.index <= i) header.loopHeader = true;
+    });
+
+    if (!next) continue;
+    int nextIndex = static_cast<int>(next - blocks.data());
+
+    if (jumps.size() == 2 && jumps[0].conditional && !jumps[1].conditional
+        && jumps[0].target == nextIndex && jumps[1].target != nextIndex) {
+      jumps[0].target = jumps[1].target;
+      jumps[0].condition = invertCondition(jumps[0].condition);
+      jumps[1].target = nextIndex;
+    }
+
+    if (!jumps.empty() && !jumps.back().conditional && jumps.back().target == nextIndex) {
+      jumps.back().encoding = TailJump::Dropped;
+    }
+  }
+
+  // Branch relaxation: All jumps start out as short jump, and are widened
+  // until all of them reach their target.  Widening is permanent, so this
+  // terminates even if the loop header padding changes.
+  size_t totalSize;
+  bool widened;
+
+  do {
+    totalSize = 0;
+    for (Block *block : layout) {
+      size_t misalignment = totalSize % LOOP_ALIGNMENT;
+      size_t padding = (misalignment > 0) ? LOOP_ALIGNMENT - misalignment : 0;
+
+      block->padding = (block->loopHeader && padding <= MAX_LOOP_PADDING) ? padding : 0;
+      block->offset = totalSize + block->padding;
+      totalSize = block->offset + block->bodySize;
+
+      for (const TailJump &jump : block->jumps) totalSize += jump.size();
+    }
+
+    widened = false;
+    for (Block *block : layout) {
+      intptr_t position = static_cast<intptr_t>(block->offset + block->bodySize);
+
+      for (TailJump &jump : block->jumps) {
+        position += jump.size();
+        if (jump.encoding != TailJump::Short) continue;
+
+        intptr_t displacement = static_cast<intptr_t>(blocks[static_cast<size_t>(jump.target)].offset) - position;
+        if (displacement != static_cast<int8_t>(displacement)) {
+          jump.encoding = TailJump::Long;
+          widened = true;
+        }
+      }
+    }
+  } while (widened);
+
+  // Merge the blocks into the final section.
+  std::vector<uintptr_t> offsets(blocks.size());
+  Section main;
+
+  main.bytes.reserve(totalSize);
+  main.references.reserve(code.references.size());
+
+  for (const Block *block : layout) {
+    main.emitNop(block->padding);
+    offsets[static_cast<size_t>(block - blocks.data())] = main.size();
+    main.append(code, block->block.begin, block->bodySize);
+
+    for (const TailJump &jump : block->jumps) {
+      if (jump.encoding == TailJump::Dropped) continue;
+
+      intptr_t end = static_cast<intptr_t>(main.size() + jump.size());
+      int32_t displacement = static_cast<int32_t>(static_cast<intptr_t>(blocks[static_cast<size_t>(jump.target)].offset) - end);
+
+      if (jump.encoding == TailJump::Short && jump.conditional) {
+        main.append(static_cast<uint8_t>(0x70 + jump.condition), static_cast<int8_t>(displacement));
+      } else if (jump.encoding == TailJump::Short) {
+        main.append(static_cast<uint8_t>(JMP_Near_rel8off), static_cast<int8_t>(displacement));
+      } else if (jump.conditional) {
+        main.append(uint8_t(0x0F), static_cast<uint8_t>(0x80 + jump.condition), displacement);
+      } else {
+        main.append(static_cast<uint8_t>(JMP_Near_rel32off), displacement);
+      }
     }
   }
 
@@ -8,11 +8,14 @@ static const MemReg MEMORY_PTR = MemReg::value("Memory");
 static const MemReg STACK_PTR = MemReg::value("Stack");
 static const MemReg RAM_PTR = MemReg::value("Ram");
 static const MemReg CURRENT_STACK_PTR(ADDRR, SR);
+static const MemReg READ_FUNC = MemReg::value("read");
+static const MemReg READ16_FUNC = MemReg::value("read16");
+static const MemReg WRITE_FUNC = MemReg::value("write");
 
 MemoryTranslator::MemoryTranslator(Section &sec) : m_sec(sec) { }
 
-static void indirectCall(Section &sec, std::string symbol) {
-  sec.emitMov(MemReg::value(symbol), RAX);
+static void indirectCall(Section &sec, const MemReg &symbol) {
+  sec.emitMov(symbol, RAX);
   sec.emitCall(RAX);
 }
 
@@ -89,7 +92,7 @@ void MemoryTranslator::resolve(Core::Instruction::Addressing mode, uint16_t addr
   case Instruction::Ind: // return Memory->read16(Op)
     this->m_sec.emitMov(MEMORY_PTR, ARG_1);
     this->m_sec.emitMov(addr, ARG_2);
-    indirectCall(this->m_sec, "read16");
+    indirectCall(this->m_sec, READ16_FUNC);
     if (destination != RESULT16) this->m_sec.emitMov(RESULT16, destination);
     break;
   case Instruction::IndX: // return Memory->read16((Op + X) & 0x00FF)
@@ -97,13 +100,13 @@ void MemoryTranslator::resolve(Core::Instruction::Addressing mode, uint16_t addr
     this->m_sec.emitAdd(addr8, ARG_2);
     this->m_sec.emitAnd(uint16_t(0x00FF), ARG_2);
     this->m_sec.emitMov(MEMORY_PTR, ARG_1);
-    indirectCall(this->m_sec, "read16");
+    indirectCall(this->m_sec, READ16_FUNC);
     if (destination != RESULT16) this->m_sec.emitMov(RESULT16, destination);
     break;
   case Instruction::IndY: // return Memory->read16(Op8) + Y
     this->m_sec.emitMov(MEMORY_PTR, ARG_1);
     this->m_sec.emitMov(addr8, ARG_2);
-    indirectCall(this->m_sec, "read16");
+    indirectCall(this->m_sec, READ16_FUNC);
     this->m_sec.emitAdd(YX, RESULT16);
     if (destination != RESULT16) this->m_sec.emitMov(RESULT16, destination);
     break;
@@ -138,7 +141,7 @@ Register MemoryTranslator::read(Core::Instruction::Addressing mode, uint16_t add
       return MEML;
     } else {
       this->m_sec.emitMov(MEMORY_PTR, ARG_1);
-      indirectCall(this->m_sec, "read");
+      indirectCall(this->m_sec, READ_FUNC);
       return RESULT8;
     }
   }
@@ -182,7 +185,7 @@ void MemoryTranslator::write(Core::Instruction::Addressing mode, uint16_t addr,
     } else {
       this->m_sec.emitMov(MEMORY_PTR, ARG_1);
       if (source != ARG_3) this->m_sec.emitMov(source, ARG_3);
-      indirectCall(this->m_sec, "write");
+      indirectCall(this->m_sec, WRITE_FUNC);
     }
 
     break;
@@ -236,14 +239,14 @@ void MemoryTranslator::rmw(Core::Instruction::Addressing mode, uint16_t addr, st
     } else {
       this->m_sec.emitMov(ADDR, ARG_2);
       this->m_sec.emitMov(MEMORY_PTR, ARG_1);
-      indirectCall(this->m_sec, "read");
+      indirectCall(this->m_sec, READ_FUNC);
 
       Register result = proc(RESULT8);
 
       this->m_sec.emitMov(MEMORY_PTR, ARG_1);
       this->m_sec.emitMov(ADDR, ARG_2);
       if (result != ARG_3) this->m_sec.emitMov(result, ARG_3);
-      indirectCall(this->m_sec, "write");
+      indirectCall(this->m_sec, WRITE_FUNC);
     }
 
     return;
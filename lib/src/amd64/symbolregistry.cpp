@@ -6,7 +6,7 @@ SymbolRegistry::SymbolRegistry() {
 }
 
 void SymbolRegistry::add(const std::string &name, Symbol symbol) {
-  auto r = this->m_symbols.insert({ name, symbol });
+  auto r = this->m_symbols.insert({ Label::symbol(name).id, symbol });
 
   if (!r.second) {
      r.first->second = symbol;
@@ -14,19 +14,32 @@ void SymbolRegistry::add(const std::string &name, Symbol symbol) {
 }
 
 void SymbolRegistry::remove(const std::string &name) {
-  this->m_symbols.erase(name);
+  this->m_symbols.erase(Label::symbol(name).id);
 }
 
 Symbol SymbolRegistry::get(const std::string &name) {
-  auto it = this->m_symbols.find(name);
-  if (it == this->m_symbols.end()) {
-    throw std::out_of_range("Missing symbol " + name);
+  return this->get(Label::symbol(name));
+}
+
+Symbol SymbolRegistry::get(Label label) {
+  const Symbol *symbol = this->find(label);
+  if (!symbol) {
+    throw std::out_of_range("Missing symbol " + label.name());
   }
 
-  return it->second;
+  return *symbol;
 }
 
 bool SymbolRegistry::has(const std::string &name) {
-  return this->m_symbols.find(name) != this->m_symbols.end();
+  return this->has(Label::symbol(name));
+}
+
+bool SymbolRegistry::has(Label label) {
+  return this->find(label) != nullptr;
+}
+
+const Symbol *SymbolRegistry::find(Label label) const {
+  auto it = this->m_symbols.find(label.id);
+  return (it != this->m_symbols.end()) ? &it->second : nullptr;
 }
 }
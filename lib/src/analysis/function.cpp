@@ -1,44 +1,80 @@
-#include <analysis/branch.hpp>
 #include <analysis/function.hpp>
 
+#include <algorithm>
+
 namespace Analysis {
 Function::Function(uint64_t tag, uint16_t begin, bool cacheable)
   : m_tag(tag), m_begin(begin), m_cacheable(cacheable)
 {
 }
 
-Function::~Function() {
-  if (this->m_branches.isDetached())
-    qDeleteAll(this->m_branches);
+void Function::reset(uint64_t tag, uint16_t begin, bool cacheable) {
+  this->m_tag = tag;
+  this->m_begin = begin;
+  this->m_cacheable = cacheable;
+
+  this->m_branches.clear();
+  this->m_addresses.clear();
+  this->m_commands.clear();
+  this->m_modes.clear();
+  this->m_cycles.clear();
+  this->m_operands.clear();
 }
 
-const QMap<uint16_t, Branch *> &Function::branches() const {
-  return this->m_branches;
+const Function::Branch *Function::branch(uint16_t address) const {
+  auto it = std::lower_bound(this->m_branches.begin(), this->m_branches.end(), address,
+                             [](const Branch &br, uint16_t addr){ return br.start < addr; });
+
+  if (it == this->m_branches.end() || it->start != address) return nullptr;
+  return &*it;
 }
 
-Branch *Function::branch(uint16_t address) {
-  return this->m_branches.value(address);
+QString Function::nativeName() const {
+  return QStringLiteral("dynarec6502_%1_%2")
+      .arg(this->m_tag, 16, 16, QLatin1Char('0'))
+      .arg(this->m_begin, 4, 16, QLatin1Char('0'));
 }
 
-const Branch *Function::branch(uint16_t address) const {
-  return this->m_branches.value(address);
+FunctionInfo Function::info() const {
+  FunctionInfo info;
+  info.tag = this->m_tag;
+  info.begin = this->m_begin;
+  info.low = info.high = this->m_begin;
+  info.cacheable = this->m_cacheable;
+
+  info.branches.reserve(this->m_branches.size());
+  for (const Branch &br : this->m_branches) info.branches.push_back(br.start);
+
+  for (size_t i = 0; i < this->m_addresses.size(); i++) {
+    uint16_t last = static_cast<uint16_t>(this->m_addresses[i] + this->instruction(i).operandSize());
+    info.low = std::min(info.low, this->m_addresses[i]);
+    info.high = std::max(info.high, last);
+  }
+
+  return info;
 }
 
-uint16_t Function::begin() const {
-  return this->m_begin;
+void Function::beginBranch(uint16_t start) {
+  uint32_t index = static_cast<uint32_t>(this->m_addresses.size());
+  this->m_branches.push_back(Branch{ start, index, index });
 }
 
-Branch *Function::root() {
-  return this->m_branches.value(this->m_begin);
+void Function::append(uint16_t address, const Core::Instruction &instr) {
+  this->m_addresses.push_back(address);
+  this->m_commands.push_back(instr.command);
+  this->m_modes.push_back(instr.addressing);
+  this->m_cycles.push_back(static_cast<uint8_t>(instr.cycles));
+  this->m_operands.push_back(instr.op16);
+  this->m_branches.back().end++;
 }
 
-void Function::add(Branch *branch) {
-  this->m_branches.insert(branch->start(), branch);
+bool Function::hasBranch(uint16_t address) const {
+  return std::any_of(this->m_branches.begin(), this->m_branches.end(),
+                     [address](const Branch &br){ return br.start == address; });
 }
 
-QString Function::nativeName() const {
-  return QStringLiteral("dynarec6502_%1_%2")
-      .arg(this->m_tag, 16, 16, QLatin1Char('0'))
-      .arg(this->m_begin, 4, 16, QLatin1Char('0'));
+void Function::finish() {
+  std::sort(this->m_branches.begin(), this->m_branches.end(),
+            [](const Branch &a, const Branch &b){ return a.start < b.start; });
 }
 }
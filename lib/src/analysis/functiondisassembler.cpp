@@ -1,79 +1,58 @@
-#include <analysis/branch.hpp>
-#include <analysis/conditionalinstruction.hpp>
 #include <analysis/function.hpp>
 #include <analysis/functiondisassembler.hpp>
 
 #include <core/data.hpp>
 #include <core/disassembler.hpp>
 
+#include <vector>
+
 namespace Analysis {
 struct FunctionDisassemblerImpl {
   Core::Data::Ptr data;
+  std::vector<uint16_t> queue; ///< Start addresses of branches to build
 
   FunctionDisassemblerImpl(const Core::Data::Ptr &d) : data(d) { }
 
-  Branch *getOrBuildBranch(Function &f, uint16_t address) {
-    Branch *br = f.branch(address);
-
-    if (!br) {
-      br = new Branch(address);
-
-      // To avoid recursive loops, add the branch now, and fill it later.
-      f.add(br);
-      this->buildBranch(f, br, address);
-    }
-
-    return br;
+  void queueBranch(Function &f, uint16_t address) {
+    if (!f.hasBranch(address)) this->queue.push_back(address);
   }
 
 #define TRACE(...)
-//#define TRACE(...) fprintf(stderr, ";"); for (int i = 0; i < depth; i++) fprintf(stderr, "  "); fprintf(stderr, __VA_ARGS__);
+//#define TRACE(...) fprintf(stderr, ";"); fprintf(stderr, __VA_ARGS__);
 
-  void buildBranch(Function &f, Branch *br, uint16_t address) {
+  void buildBranch(Function &f, uint16_t address) {
     Core::Disassembler disasm(this->data, static_cast<int>(static_cast<uint32_t>(address)));
     Core::Instruction instr(Core::Instruction::Unknown, Core::Instruction::Imp, 0);
-    Branch::List &elements = br->elements();
-
-#ifdef TRACE
-    static int depth = 0;
-    depth++;
 
     TRACE("-> Branch at %04x\n", address)
-#endif
+    f.beginBranch(address);
 
     do {
       uint16_t addr = static_cast<uint16_t>(disasm.position());
       instr = disasm.next();
       TRACE(" %04x %s\n", addr, instr.commandName())
 
-      // Discover sub branches for conditionally branching instructions.
-      // Explore both the true and false branches then.
+      f.append(addr, instr);
+
+      // Discover sub branches for conditionally branching instructions.  Both
+      // the true and false branches are built after this branch.
       if (instr.isConditionalBranching()) {
         // Start address of the next instruction.
         uint16_t nextAddr = static_cast<uint16_t>(disasm.position());
-        Branch *falsy = this->getOrBuildBranch(f, nextAddr);
-        Branch *truthy = this->getOrBuildBranch(f, instr.destinationAddress(nextAddr));
-
-        ConditionalInstruction cond(instr, truthy, falsy);
-        elements.push_back({ addr, cond });
-      } else {
-        // This is not a conditional instruction.
-        elements.push_back({ addr, instr });
+        this->queueBranch(f, instr.destinationAddress(nextAddr));
+        this->queueBranch(f, nextAddr);
       }
 
       // Break once we hit any branching instruction.
     } while(!instr.isBranching());
 
-#ifdef TRACE
     TRACE("<-- Branch end\n")
-    depth--;
-#endif
   }
 
 #undef TRACE
 };
 
-FunctionDisassembler::FunctionDisassembler(Core::Data::Ptr &data)
+FunctionDisassembler::FunctionDisassembler(const Core::Data::Ptr &data)
   : impl(new FunctionDisassemblerImpl(data))
 {
 
@@ -89,11 +68,20 @@ static bool isAddressCacheable(uint16_t address) {
   return (address >= 0x4018);
 }
 
-Function FunctionDisassembler::disassemble(uint16_t address) {
-  Function func(this->impl->data->tag(), address, isAddressCacheable(address));
+void FunctionDisassembler::disassemble(uint16_t address, Function &func) {
+  func.reset(this->impl->data->tag(), address, isAddressCacheable(address));
 
   // Discover branches going from the start address of the function.
-  this->impl->getOrBuildBranch(func, address);
-  return func;
+  std::vector<uint16_t> &queue = this->impl->queue;
+  queue.assign(1, address);
+
+  while (!queue.empty()) {
+    uint16_t start = queue.back();
+    queue.pop_back();
+
+    if (!func.hasBranch(start)) this->impl->buildBranch(func, start);
+  }
+
+  func.finish();
 }
 }
@@ -13,10 +13,68 @@ Base::Base(const Core::InesFile &ines) {
 
 }
 
+Base::Base(Ppu::Mirroring mirroring)
+  : m_nameTableMirroring(mirroring)
+{
+}
+
 Base::~Base() {
   // Do nothing.
 }
 
+void Base::saveState(Core::StateWriter &out) const {
+  Q_UNUSED(out);
+}
+
+void Base::loadState(Core::StateReader &in) {
+  Q_UNUSED(in);
+}
+
+void Base::setNameTableMemory(uint8_t *memory) {
+  this->m_nameTableMemory = memory;
+  this->mapNameTables();
+}
+
+void Base::mapChr(int page, uint8_t *data, bool writable) {
+  this->m_ppuPages[page] = data;
+  this->m_ppuWritePages[page] = writable ? data : nullptr;
+}
+
+void Base::setNameTableMirroring(Ppu::Mirroring mode) {
+  this->m_nameTableMirroring = mode;
+  this->mapNameTables();
+}
+
+/** Returns the physical name table the \a table'th name table maps to. */
+static int physicalNameTable(int table, Ppu::Mirroring mode) {
+  switch (mode) {
+  case Ppu::Single:
+    return 0;
+  case Ppu::Horizontal:
+    return table >> 1;
+  case Ppu::Vertical:
+    return table & 1;
+  case Ppu::Four:
+    return table;
+  default:
+    throw std::runtime_error("Unreachable");
+  }
+}
+
+void Base::mapNameTables() {
+  if (!this->m_nameTableMemory) return;
+
+  // The name tables at 0x2000 are mirrored at 0x3000.
+  int first = Ppu::NAME_TABLE_BASE / Ppu::PAGE_SIZE;
+  for (int page = first; page < Ppu::PAGE_COUNT; page++) {
+    int table = physicalNameTable((page - first) % 4, this->m_nameTableMirroring);
+    uint8_t *data = this->m_nameTableMemory + table * Ppu::NAME_TABLE_SIZE;
+
+    this->m_ppuPages[page] = data;
+    this->m_ppuWritePages[page] = data;
+  }
+}
+
 Base::Ptr Base::createById(int id, const Core::InesFile &ines) {
   switch (id) {
   case 0: return Ptr(new Nrom(ines));
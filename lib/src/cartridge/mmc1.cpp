@@ -1,5 +1,7 @@
 #include <cartridge/mmc1.hpp>
 
+#include <cstring>
+
 namespace Cartridge {
 enum Register0 {
   MirrorHorizontally = (1 << 0),
@@ -42,6 +44,7 @@ Mmc1::Mmc1(const Core::InesFile &ines)
   if (this->m_charIsRam) {
     this->m_charLowBank = QByteArray(Core::InesFile::VROM_BANK_SIZE, 0);
     this->m_charHighBank = QByteArray(Core::InesFile::VROM_BANK_SIZE, 0);
+    this->mapCharBanks();
   }
 
   this->updateProgramMapping();
@@ -63,6 +66,20 @@ uint64_t Mmc1::tag() const {
   return tag;
 }
 
+Base::Ptr Mmc1::clone() const {
+  std::shared_ptr<Mmc1> copy(new Mmc1(*this));
+
+  // The PPU writes into the CHR RAM through the page table, so it can't be
+  // shared.  The PRG RAM is shared until either one writes to it.
+  if (this->m_charIsRam) {
+    copy->m_charLowBank = QByteArray(this->m_charLowBank.data.constData(), this->m_charLowBank.data.size());
+    copy->m_charHighBank = QByteArray(this->m_charHighBank.data.constData(), this->m_charHighBank.data.size());
+    copy->mapCharBanks();
+  }
+
+  return copy;
+}
+
 uint8_t Mmc1::read(int address) {
   if (address < PRG_BANK0) return this->m_ramBank.ptr[address - RAM_BASE];
   else if (address < PRG_BANK1) return this->m_programLowBank.ptr[address - PRG_BANK0];
@@ -73,24 +90,53 @@ void Mmc1::write(int address, uint8_t value) {
   if (address >= REGISTER_BASE) {
     this->writeRegister(address, value);
   } else {
-    this->m_ramBank.mutablePtr[address - RAM_BASE] = value;
+    this->writableRam()[address - RAM_BASE] = value;
   }
 }
 
-uint8_t Mmc1::readChr(int address) {
-  if (address < CHR_BANK1)
-    return this->m_charLowBank.ptr[address - CHR_BANK0];
-  else
-    return this->m_charHighBank.ptr[address - CHR_BANK1];
+void Mmc1::saveState(Core::StateWriter &out) const {
+  out.write(this->m_control);
+  out.write(this->m_charLow);
+  out.write(this->m_charHigh);
+  out.write(this->m_prg);
+  out.write(this->m_serial);
+  out.write(this->m_serialPos);
+  out.write(this->m_ramBank.ptr, RAM_SIZE);
+
+  if (this->m_charIsRam) {
+    out.write(this->m_charLowBank.ptr, CHR_BANK1 - CHR_BANK0);
+    out.write(this->m_charHighBank.ptr, CHR_BANK1 - CHR_BANK0);
+  }
 }
 
-void Mmc1::writeChr(int address, uint8_t value) {
+void Mmc1::loadState(Core::StateReader &in) {
+  in.read(this->m_control);
+  in.read(this->m_charLow);
+  in.read(this->m_charHigh);
+  in.read(this->m_prg);
+  in.read(this->m_serial);
+  in.read(this->m_serialPos);
+
+  // Keep the PRG RAM shared with clones if it didn't change.
+  const uint8_t *ram = in.take(RAM_SIZE);
+  if (::memcmp(ram, this->m_ramBank.ptr, RAM_SIZE) != 0) ::memcpy(this->writableRam(), ram, RAM_SIZE);
+
   if (this->m_charIsRam) {
-    if (address < CHR_BANK1)
-      this->m_charLowBank.mutablePtr[address - CHR_BANK0] = value;
-    else
-      this->m_charHighBank.mutablePtr[address - CHR_BANK1] = value;
+    in.read(this->m_charLowBank.mutablePtr, CHR_BANK1 - CHR_BANK0);
+    in.read(this->m_charHighBank.mutablePtr, CHR_BANK1 - CHR_BANK0);
   }
+
+  this->updateProgramMapping();
+  this->updateCharMapping();
+}
+
+/** Returns the PRG RAM for writing, after detaching it from clones. */
+uint8_t *Mmc1::writableRam() {
+  if (!this->m_ramBank.data.isDetached()) {
+    this->m_ramBank = QByteArray(this->m_ramBank.data.constData(), RAM_SIZE);
+  }
+
+  return this->m_ramBank.mutablePtr;
 }
 
 void Mmc1::writeRegister(int address, uint8_t value) {
@@ -154,15 +200,28 @@ void Mmc1::updateCharMapping() {
     this->m_charHighBank = banks.at((bankIdx + 1) % banks.size());
   }
 
+  this->mapCharBanks();
+
   // Update name table mirroring mode.
   if (this->m_control & EnableMirroring) {
     if (this->m_charHigh & MirrorHorizontally) {
-      this->m_nameTableMirroring = Ppu::Horizontal;
+      this->setNameTableMirroring(Ppu::Horizontal);
     } else {
-      this->m_nameTableMirroring = Ppu::Vertical;
+      this->setNameTableMirroring(Ppu::Vertical);
     }
   } else {
-    this->m_nameTableMirroring = Ppu::Single;
+    this->setNameTableMirroring(Ppu::Single);
+  }
+}
+
+/** Maps the two 4KiB CHR banks into the PPU page table. */
+void Mmc1::mapCharBanks() {
+  static constexpr int PAGES_PER_BANK = (CHR_BANK1 - CHR_BANK0) / Ppu::PAGE_SIZE;
+
+  for (int i = 0; i < PAGES_PER_BANK; i++) {
+    int offset = i * Ppu::PAGE_SIZE;
+    this->mapChr(i, this->m_charLowBank.mutablePtr + offset, this->m_charIsRam);
+    this->mapChr(PAGES_PER_BANK + i, this->m_charHighBank.mutablePtr + offset, this->m_charIsRam);
   }
 }
 
@@ -10,7 +10,11 @@ Nrom::Nrom(const Core::InesFile &ines)
 
   // Keep pointers for faster access.
   this->m_prgFirst = reinterpret_cast<uint8_t *>(this->banks[0].data());
-  this->m_chrFirst = reinterpret_cast<uint8_t *>(this->banks[1].data());
+
+  uint8_t *chr = reinterpret_cast<uint8_t *>(this->banks[1].data());
+  for (int i = 0; i < Ppu::NAME_TABLE_BASE / Ppu::PAGE_SIZE; i++) {
+    this->mapChr(i, chr + i * Ppu::PAGE_SIZE, false);
+  }
 }
 
 Nrom::~Nrom() {
@@ -27,6 +31,11 @@ uint64_t Nrom::tag() const {
   return 0;
 }
 
+Base::Ptr Nrom::clone() const {
+  // Nothing is ever written, so the copy can point into the same banks.
+  return Base::Ptr(new Nrom(*this));
+}
+
 uint8_t Nrom::read(int address) {
   if (address < 0x8000) return 0; // Bounds check
   return this->m_prgFirst[address - 0x8000];
@@ -39,15 +48,4 @@ void Nrom::write(int address, uint8_t value) {
   // N-ROM ignores write access.
 }
 
-uint8_t Nrom::readChr(int address) {
-  return this->m_chrFirst[address];
-}
-
-void Nrom::writeChr(int address, uint8_t value) {
-  Q_UNUSED(address);
-  Q_UNUSED(value);
-
-  // N-ROM ignores write access.
-}
-
 }
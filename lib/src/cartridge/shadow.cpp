@@ -0,0 +1,70 @@
+#include <cartridge/shadow.hpp>
+
+#include <cstring>
+
+namespace Cartridge {
+
+/** Count of CHR pages in the PPU address space. */
+static constexpr int CHR_PAGES = Ppu::NAME_TABLE_BASE / Ppu::PAGE_SIZE;
+
+Shadow::Shadow(const Base::Ptr &live)
+  : Base(live->nameTableMirroring()), m_live(live)
+{
+  this->sync();
+}
+
+Shadow::~Shadow() {
+  // Nothing.
+}
+
+QString Shadow::name() const {
+  return QStringLiteral("Shadow of %1").arg(this->m_live->name());
+}
+
+uint64_t Shadow::tag() const {
+  return 0;
+}
+
+uint8_t Shadow::read(int address) {
+  Q_UNUSED(address);
+  throw std::runtime_error("Shadow cartridge has no PRG memory");
+}
+
+void Shadow::write(int address, uint8_t value) {
+  Q_UNUSED(address);
+  Q_UNUSED(value);
+  throw std::runtime_error("Shadow cartridge has no PRG memory");
+}
+
+Base::Ptr Shadow::clone() const {
+  throw std::runtime_error("Shadow cartridge can't be cloned");
+}
+
+void Shadow::sync() {
+  const uint8_t *const *pages = this->m_live->ppuPages();
+  uint8_t *const *writePages = this->m_live->ppuWritePages();
+
+  for (int i = 0; i < CHR_PAGES; i++) {
+    if (writePages[i]) {
+      std::unique_ptr<uint8_t[]> &copy = this->m_ram[pages[i]];
+      if (!copy) copy.reset(new uint8_t[Ppu::PAGE_SIZE]);
+      ::memcpy(copy.get(), pages[i], Ppu::PAGE_SIZE);
+    }
+
+    this->mapPage(i, pages[i]);
+  }
+
+  this->setNameTableMirroring(this->m_live->nameTableMirroring());
+}
+
+void Shadow::mapPage(int page, const uint8_t *live) {
+  auto it = this->m_ram.find(live);
+
+  if (it != this->m_ram.end()) {
+    this->mapChr(page, it->second.get(), true);
+  } else {
+    // CHR ROM is never written to, as it's mapped read-only.
+    this->mapChr(page, const_cast<uint8_t *>(live), false);
+  }
+}
+}
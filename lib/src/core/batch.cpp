@@ -0,0 +1,215 @@
+#include <core/batch.hpp>
+#include <core/runner.hpp>
+
+#include <ppu/renderer.hpp>
+#include <ppu/surfacemanager.hpp>
+
+#include <cpu/memory.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Core {
+
+/** Size of a frame in bytes. */
+static constexpr int FRAME_SIZE = Ppu::Renderer::WIDTH * Ppu::Renderer::HEIGHT;
+
+/** Lends the renderer of an instance its slot in the frames buffer. */
+class BatchSurface : public Ppu::SurfaceManager {
+public:
+  uint8_t *frame = nullptr;
+
+  FrameFormat frameFormat() const override
+  { return Indexed; }
+
+  void *acquireFrame() override
+  { return this->frame; }
+};
+
+struct BatchInstance {
+  std::unique_ptr<Runner> runner;
+  BatchSurface surface;
+};
+
+struct BatchPrivate {
+  typedef std::function<void(int)> Job;
+
+  std::vector<BatchInstance> instances;
+  std::unique_ptr<uint8_t[]> ram;
+  std::unique_ptr<uint8_t[]> frames;
+  bool drawFrames = false;
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake; ///< Signals a new job, or to quit
+  std::condition_variable done; ///< Signals that all workers finished the job
+  Job job;
+  uint64_t generation = 0; ///< Incremented for each job
+  int pending = 0; ///< Count of workers still on the job
+  bool quit = false;
+  std::exception_ptr error;
+
+  /** First instance of the \a worker.  Each one has a contiguous range. */
+  int firstInstance(int worker) const {
+    return static_cast<int>(this->instances.size() * worker / this->workers.size());
+  }
+
+  /** Runs \a job for each instance on its worker, and waits for all of them. */
+  void run(const Job &job) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->job = job;
+      this->generation++;
+      this->pending = static_cast<int>(this->workers.size());
+    }
+
+    this->wake.notify_all();
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->done.wait(lock, [this]{ return this->pending == 0; });
+
+    if (this->error) {
+      std::exception_ptr error = this->error;
+      this->error = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+  void work(int worker) {
+    uint64_t seen = 0;
+
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(lock, [this, seen]{ return this->quit || this->generation != seen; });
+        if (this->quit) return;
+        seen = this->generation;
+      }
+
+      // The job stays put until all workers are done with it.
+      try {
+        for (int i = this->firstInstance(worker); i < this->firstInstance(worker + 1); i++) {
+          this->job(i);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->error) this->error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (--this->pending == 0) this->done.notify_one();
+    }
+  }
+
+  /** Destroys the instances on their workers, and then stops the workers. */
+  void shutDown() {
+    this->run([this](int i) { this->instances[i].runner.reset(); });
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->quit = true;
+    }
+
+    this->wake.notify_all();
+    for (std::thread &worker : this->workers) {
+      worker.join();
+    }
+  }
+
+  /** Copies the RAM of the instance at \a index into the RAM buffer. */
+  void copyRam(int index) {
+    uint8_t *ram = this->instances[index].runner->ram()->ram();
+    ::memcpy(this->ram.get() + index * Cpu::Memory::RAM_SIZE, ram, Cpu::Memory::RAM_SIZE);
+  }
+};
+
+Batch::Batch(const InesFile &ines, const QString &cpuType, int count, int threads)
+  : d(new BatchPrivate)
+{
+  if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+  threads = std::max(1, std::min(threads, count));
+
+  this->d->instances.resize(count);
+  this->d->ram.reset(new uint8_t[count * Cpu::Memory::RAM_SIZE]);
+  this->d->frames.reset(new uint8_t[count * FRAME_SIZE]());
+
+  for (int i = 0; i < threads; i++) {
+    this->d->workers.emplace_back([this, i]{ this->d->work(i); });
+  }
+
+  // Create the instances on their workers, so their memory is local to them.
+  try {
+    this->d->run([this, &ines, &cpuType](int i) {
+      BatchInstance &instance = this->d->instances[i];
+      instance.surface.frame = this->d->frames.get() + i * FRAME_SIZE;
+      instance.runner.reset(new Runner(ines, cpuType, &instance.surface));
+      this->d->copyRam(i);
+    });
+  } catch (...) {
+    this->d->shutDown();
+    delete this->d;
+    throw;
+  }
+}
+
+Batch::~Batch() {
+  this->d->shutDown();
+  delete this->d;
+}
+
+int Batch::count() const {
+  return static_cast<int>(this->d->instances.size());
+}
+
+int Batch::threadCount() const {
+  return static_cast<int>(this->d->workers.size());
+}
+
+bool Batch::drawFrames() const {
+  return this->d->drawFrames;
+}
+
+void Batch::setDrawFrames(bool draw) {
+  this->d->drawFrames = draw;
+}
+
+void Batch::step(const uint8_t *firstPlayer, const uint8_t *secondPlayer, int frames) {
+  bool draw = this->d->drawFrames;
+
+  this->d->run([this, firstPlayer, secondPlayer, frames, draw](int i) {
+    Runner *runner = this->d->instances[i].runner.get();
+    runner->ram()->firstPlayer().setButtons(firstPlayer ? firstPlayer[i] : 0);
+    runner->ram()->secondPlayer().setButtons(secondPlayer ? secondPlayer[i] : 0);
+
+    for (int frame = 1; frame <= frames; frame++) {
+      runner->tick(!draw || frame < frames);
+    }
+
+    this->d->copyRam(i);
+  });
+}
+
+void Batch::reset(bool hard) {
+  this->d->run([this, hard](int i) {
+    this->d->instances[i].runner->reset(hard);
+    this->d->copyRam(i);
+  });
+}
+
+const uint8_t *Batch::ram() const {
+  return this->d->ram.get();
+}
+
+const uint8_t *Batch::frames() const {
+  return this->d->frames.get();
+}
+
+Runner *Batch::runner(int index) {
+  return this->d->instances[index].runner.get();
+}
+}
@@ -0,0 +1,181 @@
+#include <core/rewindbuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Core {
+
+/** Size of the header of each run in a delta: Skipped and changed bytes. */
+static constexpr int RUN_HEADER_SIZE = 2 * sizeof(uint16_t);
+
+/** Longest run of either kind, longer ones are split up. */
+static constexpr int MAX_RUN = UINT16_MAX;
+
+/**
+ * Runs of unchanged bytes shorter than this are kept in the changed run, as
+ * the header of a new run would take up about as much.
+ */
+static constexpr int MIN_GAP = 8;
+
+/** Count of equal bytes at the start of \a a and \a b, up to \a size. */
+static int equalPrefix(const uint8_t *a, const uint8_t *b, int size) {
+  int i = 0;
+
+  // Compare a word at a time, the compiler vectorizes this.
+  for (; i + 8 <= size; i += 8) {
+    uint64_t x, y;
+    ::memcpy(&x, a + i, sizeof(x));
+    ::memcpy(&y, b + i, sizeof(y));
+    if (x != y) break;
+  }
+
+  while (i < size && a[i] == b[i]) i++;
+  return i;
+}
+
+RewindBuffer::RewindBuffer(int stateSize, int frames, int capacity)
+  : m_stateSize(stateSize),
+    // Each changed run is followed by a gap of at least MIN_GAP bytes.
+    m_maxDeltaSize(stateSize + (stateSize / (MIN_GAP + 1) + stateSize / MAX_RUN + 2) * 2 * RUN_HEADER_SIZE),
+    m_current(new uint8_t[stateSize]), m_next(new uint8_t[stateSize]),
+    m_capacity(std::max(capacity, this->m_maxDeltaSize)),
+    m_records(std::max(frames, 1))
+{
+  this->m_deltas.reset(new uint8_t[this->m_capacity]);
+  this->m_scratch.reset(new uint8_t[this->m_maxDeltaSize]);
+}
+
+RewindBuffer::~RewindBuffer() {
+  // Nothing.
+}
+
+void RewindBuffer::record() {
+  std::swap(this->m_current, this->m_next);
+
+  if (!this->m_hasCurrent) {
+    this->m_hasCurrent = true;
+    return;
+  }
+
+  // Encode first, so only as many old deltas are dropped as needed.
+  int size = this->encode(this->m_scratch.get());
+
+  if (this->m_count == static_cast<int>(this->m_records.size())) this->dropOldest();
+  this->reserve(size);
+
+  int index = (this->m_first + this->m_count) % this->m_records.size();
+  Record &record = this->m_records[index];
+  record.offset = this->m_head;
+  record.size = size;
+  ::memcpy(this->m_deltas.get() + this->m_head, this->m_scratch.get(), size);
+
+  this->m_head += record.size;
+  this->m_count++;
+}
+
+bool RewindBuffer::stepBack() {
+  if (this->m_count == 0) return false;
+
+  int index = (this->m_first + this->m_count - 1) % this->m_records.size();
+  const Record &record = this->m_records[index];
+  this->decode(this->m_deltas.get() + record.offset, record.size);
+
+  this->m_head = record.offset;
+  this->m_count--;
+  return true;
+}
+
+void RewindBuffer::clear() {
+  this->m_hasCurrent = false;
+  this->m_head = 0;
+  this->m_first = 0;
+  this->m_count = 0;
+}
+
+/** Drops the oldest deltas until \a size bytes fit at the head. */
+void RewindBuffer::reserve(int size) {
+  if (this->m_head + size > this->m_capacity) {
+    // The deltas behind the head are the oldest ones.  Drop them to wrap.
+    while (this->m_count > 0 && this->m_records[this->m_first].offset >= this->m_head) {
+      this->dropOldest();
+    }
+
+    this->m_head = 0;
+  }
+
+  while (this->m_count > 0) {
+    int offset = this->m_records[this->m_first].offset;
+    if (offset < this->m_head || offset >= this->m_head + size) break;
+    this->dropOldest();
+  }
+}
+
+void RewindBuffer::dropOldest() {
+  this->m_first = (this->m_first + 1) % this->m_records.size();
+  this->m_count--;
+}
+
+/**
+ * Writes the delta from the state in \c m_current back to the one in
+ * \c m_next into \a out.  Returns its size.
+ */
+int RewindBuffer::encode(uint8_t *out) const {
+  const uint8_t *a = this->m_current.get();
+  const uint8_t *b = this->m_next.get();
+  int size = this->m_stateSize;
+  uint8_t *begin = out;
+  int pos = 0;
+
+  while (pos < size) {
+    int skip = std::min(equalPrefix(a + pos, b + pos, size - pos), MAX_RUN);
+    if (pos + skip == size) break;
+
+    // Find the end of the changed run, which may contain short gaps.
+    int start = pos + skip;
+    int end = start;
+    while (end < size && end - start < MAX_RUN) {
+      while (end < size && end - start < MAX_RUN && a[end] != b[end]) end++;
+
+      int gap = equalPrefix(a + end, b + end, size - end);
+      if (gap >= MIN_GAP || end + gap == size) break;
+      end = std::min(end + gap, start + MAX_RUN);
+    }
+
+    uint16_t header[2] = { static_cast<uint16_t>(skip), static_cast<uint16_t>(end - start) };
+    ::memcpy(out, header, RUN_HEADER_SIZE);
+    out += RUN_HEADER_SIZE;
+
+    for (int i = start; i < end; i++) {
+      *out++ = a[i] ^ b[i];
+    }
+
+    pos = end;
+  }
+
+  // Deltas are never empty, so the offset of each one is unique.
+  if (out == begin) {
+    ::memset(out, 0, RUN_HEADER_SIZE);
+    out += RUN_HEADER_SIZE;
+  }
+
+  return static_cast<int>(out - begin);
+}
+
+/** Applies the delta in \a in of \a size bytes onto \c m_current. */
+void RewindBuffer::decode(const uint8_t *in, int size) {
+  uint8_t *state = this->m_current.get();
+  const uint8_t *end = in + size;
+  int pos = 0;
+
+  while (in < end) {
+    uint16_t header[2];
+    ::memcpy(header, in, RUN_HEADER_SIZE);
+    in += RUN_HEADER_SIZE;
+
+    pos += header[0];
+    for (int i = 0; i < header[1]; i++) {
+      state[pos++] ^= *in++;
+    }
+  }
+}
+}
@@ -1,4 +1,8 @@
 #include <core/runner.hpp>
+#include <core/rewindbuffer.hpp>
+#include <core/savestate.hpp>
+#include <core/scheduler.hpp>
+#include <core/timing.hpp>
 
 #include <ppu/surfacemanager.hpp>
 #include <ppu/memory.hpp>
@@ -12,11 +16,30 @@
 
 #include <QDebug>
 
+#include <cstring>
+#include <stdexcept>
+
 // If defined, installs a Cpu::DumpHook into the CPU.  Cores which support it
 // will then log all instructions to STDERR.
 // The dynarec Core uses environment variables instead.
 //#define TRACE_INSTRUCTIONS
 
+/** Magic bytes at the start of save states. */
+static constexpr char STATE_MAGIC[4] = { 'D', 'y', 'S', 'S' };
+
+/** Version of the save state format.  Increment on any change to it. */
+static constexpr uint16_t STATE_VERSION = 2;
+
+/** Space for rewind deltas per frame, on average. */
+static constexpr int REWIND_BYTES_PER_FRAME = 1024;
+
+/** Header of save states. */
+struct StateHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t mapper;
+};
+
 struct RunnerPrivate {
   RunnerPrivate(const QString &type, const Core::InesFile &i) : cpuType(type), ines(i) { }
 
@@ -31,28 +54,116 @@ struct RunnerPrivate {
   Ppu::Memory::Ptr vram;
   Ppu::Renderer *renderer;
 
-  int cycles = 0;
+  Core::Timing timing;
+  Core::Scheduler scheduler;
+  int scanLineEvent;
+  int64_t frameStart = 0; ///< Time the current frame started at
+  bool frameDone = false;
+
+  int rewindLength = 0;
+  std::unique_ptr<Core::RewindBuffer> rewind;
+
+  int runAhead = 0;
+  std::unique_ptr<uint8_t[]> runAheadState; ///< State of the real frame
+
+  /** Draws the scan line which just ended, and schedules the next one. */
+  void handleScanLine() {
+    if (this->renderer->drawScanLine()) {
+      this->frameStart += this->timing.frameLength();
+      this->frameDone = true;
+    }
+
+    int line = this->renderer->nextScanLine();
+    this->scheduler.schedule(this->scanLineEvent, this->frameStart + (line + 1) * this->timing.lineLength());
+  }
+
+  /** Writes the state of all components into \a out. */
+  void saveState(Core::StateWriter &out) const {
+    StateHeader header;
+    ::memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.version = STATE_VERSION;
+    header.mapper = static_cast<uint16_t>(this->ines.mapperType());
+    out.write(header);
+
+    out.write(this->cpu->state());
+    this->ram->saveState(out);
+    this->cartridge->saveState(out);
+    this->vram->saveState(out);
+    this->renderer->saveState(out);
+    this->scheduler.saveState(out);
+    out.write(this->frameStart);
+  }
+
+  /** Emulates a frame, drawing it unless \a skipRaster is \c true. */
+  void runFrame(bool skipRaster) {
+    this->renderer->setSkipRaster(skipRaster);
+    this->frameDone = false;
+
+    while (!this->frameDone) {
+      this->runToNextEvent();
+    }
+  }
+
+  /** Runs the CPU until the next event, and dispatches it. */
+  void runToNextEvent() {
+    int64_t cycles = this->timing.cpuCycles(this->scheduler.nextDeadline() - this->scheduler.now());
+
+    // The CPU may overshoot the deadline, which shortens the next run.
+    if (cycles > 0) {
+      int remaining = this->cpu->run(static_cast<int>(cycles));
+      this->scheduler.advance((cycles - remaining) * this->timing.cpuDivider);
+    }
+
+    this->scheduler.dispatch();
+  }
 };
 
 namespace Core {
 Runner::Runner(const Core::InesFile &ines, const QString &cpuType, Ppu::SurfaceManager *surfaces, QObject *parent)
   : QObject(parent), d(new RunnerPrivate(cpuType, ines))
 {
+  qDebug() << "Using CPU core" << cpuType;
+
+  this->setup(Cartridge::Base::createById(ines.mapperType(), ines), surfaces);
+  this->reset();
+}
+
+Runner::Runner(const Runner &from, Ppu::SurfaceManager *surfaces, QObject *parent)
+  : QObject(parent), d(new RunnerPrivate(from.d->cpuType, from.d->ines))
+{
+  this->setup(from.d->cartridge->clone(), surfaces);
+  this->d->cpu->shareCode(from.d->cpu);
+
+  int size = from.stateSize();
+  std::unique_ptr<uint8_t[]> state(new uint8_t[size]);
+  from.saveState(state.get());
+  this->loadState(state.get(), size);
+}
+
+void Runner::setup(const std::shared_ptr<Cartridge::Base> &cartridge, Ppu::SurfaceManager *surfaces) {
   this->d->surfaces = surfaces;
-  this->d->cartridge = Cartridge::Base::createById(ines.mapperType(), ines);
+  this->d->cartridge = cartridge;
 
   this->d->vram = Ppu::Memory::Ptr(new Ppu::Memory(this->d->cartridge));
   this->d->ram = Cpu::Memory::Ptr(new Cpu::Memory(this->d->vram, this->d->cartridge));
-  this->d->cpu = Cpu::Base::createByName(cpuType, this->d->ram, this);
-
-  qDebug() << "Using CPU core" << cpuType;
+  this->d->cpu = Cpu::Base::createByName(this->d->cpuType, this->d->ram, this);
 
 #ifdef TRACE_INSTRUCTIONS
   this->d->cpu->setHook(new Cpu::DumpHook);
 #endif
 
   this->d->renderer = new Ppu::Renderer(this->d->vram.get(), surfaces, this->d->cpu);
-  this->reset();
+
+  bool pal = this->d->ines.flags().testFlag(InesFile::IsPal);
+  this->d->timing = pal ? Timing::pal() : Timing::ntsc();
+  this->d->renderer->setScanLineCount(this->d->timing.linesPerFrame);
+
+  this->d->scanLineEvent = this->d->scheduler.add([this]{ this->d->handleScanLine(); });
+  this->d->scheduler.schedule(this->d->scanLineEvent, this->d->timing.lineLength());
+}
+
+Runner *Runner::fork(Ppu::SurfaceManager *surfaces, QObject *parent) const {
+  return new Runner(*this, surfaces, parent);
 }
 
 Runner::~Runner() {
@@ -72,28 +183,130 @@ Ppu::Memory *Runner::vram() {
   return this->d->vram.get();
 }
 
+Cpu::Base *Runner::cpu() {
+  return this->d->cpu;
+}
+
 const QString &Runner::cpuImplementation() const {
   return this->d->cpuType;
 }
 
+bool Runner::threadedRendering() const {
+  return this->d->renderer->isThreaded();
+}
+
+void Runner::setThreadedRendering(bool threaded) {
+  this->d->renderer->setThreaded(threaded);
+}
+
+int Runner::stateSize() const {
+  Core::StateWriter counter;
+  this->d->saveState(counter);
+  return counter.size();
+}
+
+void Runner::saveState(uint8_t *buffer) const {
+  Core::StateWriter out(buffer);
+  this->d->saveState(out);
+}
+
+void Runner::loadState(const uint8_t *buffer, int size) {
+  Core::StateReader in(buffer, size);
+
+  StateHeader header;
+  in.read(header);
+  if (::memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0) {
+    throw std::runtime_error("Not a save state");
+  } else if (header.version != STATE_VERSION) {
+    throw std::runtime_error("Save state version is not supported");
+  } else if (header.mapper != this->d->ines.mapperType()) {
+    throw std::runtime_error("Save state is of another mapper");
+  }
+
+  in.read(this->d->cpu->state());
+  this->d->ram->loadState(in);
+  this->d->cartridge->loadState(in);
+  this->d->vram->loadState(in);
+  this->d->renderer->loadState(in);
+  this->d->scheduler.loadState(in);
+  in.read(this->d->frameStart);
+
+  this->d->cpu->invalidateRamCode();
+}
+
+int Runner::rewindLength() const {
+  return this->d->rewindLength;
+}
+
+void Runner::setRewindLength(int frames) {
+  this->d->rewindLength = frames;
+  this->d->rewind.reset();
+
+  if (frames > 0) {
+    int capacity = frames * REWIND_BYTES_PER_FRAME;
+    this->d->rewind.reset(new RewindBuffer(this->stateSize(), frames, capacity));
+  }
+}
+
+int Runner::rewindDepth() const {
+  return this->d->rewind ? this->d->rewind->depth() : 0;
+}
+
+bool Runner::rewind() {
+  RewindBuffer *rewind = this->d->rewind.get();
+  if (!rewind || !rewind->stepBack()) return false;
+
+  this->loadState(rewind->current(), this->stateSize());
+  return true;
+}
+
+int Runner::runAhead() const {
+  return this->d->runAhead;
+}
+
+void Runner::setRunAhead(int frames) {
+  this->d->runAhead = frames;
+  this->d->runAheadState.reset(frames > 0 ? new uint8_t[this->stateSize()] : nullptr);
+}
+
 void Runner::reset(bool hard) {
   if (hard) {
     this->d->ram->reset();
+    this->d->cpu->invalidateRamCode();
   }
 
   this->d->vram->reset();
+  this->d->renderer->synchronize();
   this->d->cpu->jumpToVector(Cpu::Interrupt::Reset);
 }
 
-void Runner::tick() {
-  constexpr int TOTAL_CYCLES = 29781;
-  constexpr int PER_LINE = TOTAL_CYCLES / 260;
-  constexpr int LEFTOVER = TOTAL_CYCLES - PER_LINE * 260; // = 141
+Scheduler *Runner::scheduler() {
+  return &this->d->scheduler;
+}
+
+const Timing &Runner::timing() const {
+  return this->d->timing;
+}
 
-  this->d->cycles += LEFTOVER;
-  do {
-    this->d->cycles = this->d->cpu->run(this->d->cycles + PER_LINE);
-  } while (!this->d->renderer->drawScanLine());
+void Runner::tick(bool skipRaster) {
+  int ahead = skipRaster ? 0 : this->d->runAhead;
+  this->d->runFrame(skipRaster || ahead > 0);
+
+  if (RewindBuffer *rewind = this->d->rewind.get()) {
+    this->saveState(rewind->next());
+    rewind->record();
+  }
+
+  if (ahead > 0) {
+    uint8_t *state = this->d->runAheadState.get();
+    this->saveState(state);
+
+    for (int i = 1; i <= ahead; i++) {
+      this->d->runFrame(i < ahead);
+    }
+
+    this->loadState(state, this->stateSize());
+  }
 }
 
 }
@@ -0,0 +1,67 @@
+#include <core/scheduler.hpp>
+
+namespace Core {
+Scheduler::Scheduler() {
+  // Nothing.
+}
+
+Scheduler::~Scheduler() {
+  // Nothing.
+}
+
+int Scheduler::add(const Handler &handler) {
+  this->m_events.push_back(Event{ handler, NEVER });
+  return static_cast<int>(this->m_events.size()) - 1;
+}
+
+void Scheduler::schedule(int event, int64_t deadline) {
+  this->m_events[event].deadline = deadline;
+  if (deadline < this->m_next) this->m_next = deadline;
+}
+
+void Scheduler::cancel(int event) {
+  this->m_events[event].deadline = NEVER;
+  this->updateNext();
+}
+
+void Scheduler::dispatch() {
+  // There's only a handful of events, so finding the next one is cheaper
+  // than keeping them sorted.
+  while (this->m_next <= this->m_now) {
+    Event *due = nullptr;
+    for (Event &event : this->m_events) {
+      if (!due || event.deadline < due->deadline) due = &event;
+    }
+
+    due->deadline = NEVER;
+    this->updateNext();
+    due->handler();
+  }
+}
+
+void Scheduler::saveState(Core::StateWriter &out) const {
+  out.write(this->m_now);
+
+  for (const Event &event : this->m_events) {
+    out.write(event.deadline);
+  }
+}
+
+void Scheduler::loadState(Core::StateReader &in) {
+  in.read(this->m_now);
+
+  for (Event &event : this->m_events) {
+    in.read(event.deadline);
+  }
+
+  this->updateNext();
+}
+
+void Scheduler::updateNext() {
+  this->m_next = NEVER;
+
+  for (const Event &event : this->m_events) {
+    if (event.deadline < this->m_next) this->m_next = event.deadline;
+  }
+}
+}
@@ -1,6 +1,7 @@
 #include <cpu/base.hpp>
 
 #include <interpret/core_interpret.hpp>
+#include <interpret/core_threaded.hpp>
 
 #ifdef DYNES_CORE_DYNAREC_LLVM
 #include <dynarec/core_dynarec.hpp>
@@ -24,6 +25,14 @@ Base::~Base() {
   // C++ does the rest.
 }
 
+void Base::invalidateRamCode() {
+  // Nothing.
+}
+
+void Base::shareCode(const Base *from) {
+  Q_UNUSED(from);
+}
+
 void Base::jumpToVector(Interrupt intr) {
   // An indiret jump, like `JMP (VECTOR)`
   uint16_t indirect = this->m_mem->read16(Cpu::interruptVectorAddress(intr));
@@ -50,9 +59,34 @@ void Base::interrupt(Interrupt intr, bool force) {
   this->jumpToVector(intr);
 }
 
+void Base::raise(Interrupt intr) {
+  this->m_state.interrupts |= static_cast<uint8_t>(1 << intr);
+}
+
+bool Base::servicePending() {
+  static constexpr Interrupt priority[] = { NonMaskable, Service };
+
+  for (Interrupt intr : priority) {
+    uint8_t line = static_cast<uint8_t>(1 << intr);
+    if (!(this->m_state.interrupts & line)) continue;
+
+    if (Cpu::isInterruptMaskable(intr) && this->m_state.flags().testFlag(Flag::Interrupt))
+      continue; // Masked, keep it pending until the guest clears the flag.
+
+    this->m_state.interrupts &= ~line;
+    this->interrupt(intr, true);
+    return true;
+  }
+
+  return false;
+}
+
+// The stack is always in RAM, so the push and pull functions skip the memory
+// mapping and go straight to it.
+
 uint8_t Base::pull() {
   this->m_state.s += sizeof(uint8_t);
-  return this->m_mem->read(Cpu::STACK_BASE + this->m_state.s);
+  return this->m_mem->ram()[Cpu::STACK_BASE + this->m_state.s];
 }
 
 uint16_t Base::pull16() {
@@ -63,7 +97,7 @@ uint16_t Base::pull16() {
 }
 
 void Base::push(uint8_t value) {
-  this->m_mem->write(Cpu::STACK_BASE + this->m_state.s, value);
+  this->m_mem->ram()[Cpu::STACK_BASE + this->m_state.s] = value;
   this->m_state.s -= sizeof(uint8_t);
 }
 
@@ -79,6 +113,8 @@ Memory::Ptr &Base::mem() {
 Base *Base::createByName(const QString &name, const Memory::Ptr &mem, QObject *parent) {
   if (name == QStringLiteral("interpret")) {
     return new Interpret::Core(mem, State(), parent);
+  } else if (name == QStringLiteral("threaded")) {
+    return new Interpret::ThreadedCore(mem, State(), parent);
 #ifdef DYNES_CORE_DYNAREC_LLVM
   } else if (name == QStringLiteral("dynarec")) {
     return new Dynarec::Core(mem, State(), parent);
@@ -111,6 +147,7 @@ void Base::setHook(Hook *hook) {
 QMap<QString, QString> Base::availableImplementations() {
   return {
     { "interpret", tr("Interpret") },
+    { "threaded", tr("Threaded interpreter") },
 #ifdef DYNES_CORE_DYNAREC_LLVM
     { "dynarec", tr("Dynamically recompiler (LLVM JIT)") },
 #endif
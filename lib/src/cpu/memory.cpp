@@ -67,6 +67,24 @@ void Memory::reset() {
   ::memset(this->m_ram, 0x00, sizeof(this->m_ram));
 }
 
+void Memory::saveState(Core::StateWriter &out) const {
+  out.write(this->m_ram);
+  out.write(this->m_firstPlayer.serialPosition());
+  out.write(this->m_secondPlayer.serialPosition());
+}
+
+void Memory::loadState(Core::StateReader &in) {
+  in.read(this->m_ram);
+
+  // Only restore where the game is in reading the pads.  The held buttons are
+  // live input, and stay as they are.
+  uint8_t position;
+  in.read(position);
+  this->m_firstPlayer.setSerialPosition(position);
+  in.read(position);
+  this->m_secondPlayer.setSerialPosition(position);
+}
+
 uint8_t Memory::readIo(int offset) {
   switch (offset) {
   case 0x14: return 0;
@@ -89,6 +89,10 @@ struct CorePrivate {
 
     bool running = true;
     while (running && state.cycles > 0) {
+      // The generated code doesn't check for interrupts, but returns to us
+      // often enough to take them here.
+      if (state.interrupts) this->core->servicePending();
+
       this->callFunctionOnce(state);
 
       switch (state.reason) {
@@ -1,4 +1,3 @@
-#include <analysis/branch.hpp>
 #include <dynarec/function.hpp>
 
 namespace Dynarec {
@@ -2,7 +2,7 @@
 #include <dynarec/functioncompiler.hpp>
 #include <dynarec/functionframe.hpp>
 #include <dynarec/common.hpp>
-#include <analysis/branch.hpp>
+#include <analysis/function.hpp>
 #include <dynarec/instructiontranslator.hpp>
 
 #include <llvm/IR/Verifier.h>
@@ -16,6 +16,7 @@ struct FunctionCompilerImpl {
   BlockMap blocks;
   FunctionFrame *frame = nullptr;
   llvm::Function *function;
+  const Analysis::Function *analyzed = nullptr;
 
   FunctionCompilerImpl(FunctionCompiler *p, Compiler &c, llvm::Module *m)
     : parent(p), compiler(c), module(m)
@@ -42,24 +43,20 @@ struct FunctionCompilerImpl {
 #endif
   }
 
-  bool isBranching(Analysis::Branch::Instruction &instr) {
-    if (const Core::Instruction *ptr = std::get_if<Core::Instruction>(&instr)) {
-      return ptr->isBranching();
-    } else {
-      // In this case it's a ConditionalInstruction, which is always branching.
-      return true;
+  llvm::BasicBlock *compileBranch(uint16_t start) {
+    const Analysis::Function::Branch *branch = this->analyzed->branch(start);
+    if (!branch) {
+      throw std::runtime_error("No branch to compile at " + std::to_string(start));
     }
-  }
 
-  llvm::BasicBlock *compileBranch(Analysis::Branch *branch) {
-    llvm::BasicBlock *start = nullptr;
+    llvm::BasicBlock *begin = nullptr;
     llvm::BasicBlock *previous = nullptr;
     Builder b(this->module->getContext());
 
-    for(const Analysis::Branch::Element &el : branch->elements()) {
-      uint16_t address = el.first;
+    for (size_t i = branch->begin; i < branch->end; i++) {
+      uint16_t address = this->analyzed->address(i);
       InstructionBlock instrBlock = this->blocks.value(address);
-      Analysis::Branch::Instruction instr = el.second;
+      Core::Instruction instr = this->analyzed->instruction(i);
 
       if (!instrBlock.out) { // Lazy compile
         instrBlock = this->compileInstruction(address, instr);
@@ -72,33 +69,21 @@ struct FunctionCompilerImpl {
         b.CreateBr(instrBlock.in);
       }
 
-      if (!start) start = instrBlock.in;
+      if (!begin) begin = instrBlock.in;
       previous = instrBlock.out;
     }
 
-    return start;
+    return begin;
   }
 
-  QString instructionBranchName(uint16_t addr, Analysis::Branch::Instruction &instr) {
-    const char *command = "?";
-    const char *mode = "?";
-
-    if (const Core::Instruction *ptr = std::get_if<Core::Instruction>(&instr)) {
-      command = ptr->commandName();
-      mode = ptr->addressingName();
-    } else {
-      Analysis::ConditionalInstruction cond = std::get<Analysis::ConditionalInstruction>(instr);
-      command = cond.commandName();
-      mode = cond.addressingName();
-    }
-
+  QString instructionBranchName(uint16_t addr, const Core::Instruction &instr) {
     return QStringLiteral("instr_%1_%2_%3")
         .arg(addr, 4, 16, QLatin1Char('0'))
-        .arg(QLatin1String(command))
-        .arg(QLatin1String(mode));
+        .arg(QLatin1String(instr.commandName()))
+        .arg(QLatin1String(instr.addressingName()));
   }
 
-  InstructionBlock compileInstruction(uint16_t addr, Analysis::Branch::Instruction &instr) {
+  InstructionBlock compileInstruction(uint16_t addr, const Core::Instruction &instr) {
     QString branchName = this->instructionBranchName(addr, instr);
     InstructionBlock iblocks;
 
@@ -136,9 +121,9 @@ struct FunctionCompilerImpl {
     this->frame->initialize(builder, this->function->arg_begin());
 
     // Compile branches
-    QMap<uint16_t, Analysis::Branch *> funcBranches = function->analyzed().branches();
-    for (Analysis::Branch *branch : funcBranches) {
-      this->compileBranch(branch);
+    this->analyzed = &function->analyzed();
+    for (const Analysis::Function::Branch &branch : this->analyzed->branches()) {
+      this->compileBranch(branch.start);
     }
 
     // Branch from the "entry" block into the first instruction block.
@@ -173,8 +158,8 @@ FunctionFrame &FunctionCompiler::frame() {
   return *this->impl->frame;
 }
 
-llvm::BasicBlock *FunctionCompiler::compileBranch(Analysis::Branch *branch) {
-  return this->impl->compileBranch(branch);
+llvm::BasicBlock *FunctionCompiler::compileBranch(uint16_t start) {
+  return this->impl->compileBranch(start);
 }
 
 }
@@ -4,7 +4,6 @@
 #include <dynarec/structtranslator.hpp>
 #include <dynarec/configuration.hpp>
 
-#include <variant>
 #include <cpu.hpp>
 
 #include <cpu/state.hpp>
@@ -22,12 +21,12 @@ struct Impl {
   Impl(FunctionCompiler &c, llvm::Function *f) : compiler(c), memory(c), function(f) {
   }
 
-  void translate(Builder &b, uint16_t address, const Analysis::Branch::Instruction &instr) {
-    if (const Core::Instruction *ptr = std::get_if<Core::Instruction>(&instr)) {
-      if (CONFIGURATION.trace) this->traceInstruction(b, address, *ptr);
-      this->translate(b, address, *ptr);
+  void translateAny(Builder &b, uint16_t address, const Core::Instruction &instr) {
+    if (!instr.isConditionalBranching()) {
+      if (CONFIGURATION.trace) this->traceInstruction(b, address, instr);
+      this->translate(b, address, instr);
     } else {
-      this->translate(b, address, std::get<Analysis::ConditionalInstruction>(instr));
+      this->translateConditional(b, address, instr);
     }
   }
 
@@ -308,7 +307,7 @@ struct Impl {
     }
   }
 
-  void translate(Builder &b, uint16_t address, const Analysis::ConditionalInstruction &instr) {
+  void translateConditional(Builder &b, uint16_t address, const Core::Instruction &instr) {
     using Core::Instruction;
 
     this->reduceCycles(b, instr.cycles);
@@ -324,28 +323,28 @@ struct Impl {
 
     switch (instr.command) {
     case Instruction::BCC:
-      this->conditionalBranch(b, Cpu::Flag::Carry, false, instr);
+      this->conditionalBranch(b, Cpu::Flag::Carry, false, address, instr);
       break;
     case Instruction::BCS:
-      this->conditionalBranch(b, Cpu::Flag::Carry, true, instr);
+      this->conditionalBranch(b, Cpu::Flag::Carry, true, address, instr);
       break;
     case Instruction::BEQ:
-      this->conditionalBranch(b, Cpu::Flag::Zero, true, instr);
+      this->conditionalBranch(b, Cpu::Flag::Zero, true, address, instr);
       break;
     case Instruction::BMI:
-      this->conditionalBranch(b, Cpu::Flag::Negative, true, instr);
+      this->conditionalBranch(b, Cpu::Flag::Negative, true, address, instr);
       break;
     case Instruction::BNE:
-      this->conditionalBranch(b, Cpu::Flag::Zero, false, instr);
+      this->conditionalBranch(b, Cpu::Flag::Zero, false, address, instr);
       break;
     case Instruction::BPL:
-      this->conditionalBranch(b, Cpu::Flag::Negative, false, instr);
+      this->conditionalBranch(b, Cpu::Flag::Negative, false, address, instr);
       break;
     case Instruction::BVC:
-      this->conditionalBranch(b, Cpu::Flag::Overflow, false, instr);
+      this->conditionalBranch(b, Cpu::Flag::Overflow, false, address, instr);
       break;
     case Instruction::BVS:
-      this->conditionalBranch(b, Cpu::Flag::Overflow, true, instr);
+      this->conditionalBranch(b, Cpu::Flag::Overflow, true, address, instr);
       break;
     default:
       throw std::runtime_error("Missing case for conditional instruction!");
@@ -355,9 +354,10 @@ struct Impl {
   /**** Reusable complex instruction implementations. ****/
 
   void conditionalBranch(Builder &b, Cpu::Flag flag, bool expect,
-                         const Analysis::ConditionalInstruction &instr) {
-    llvm::BasicBlock *truthy = this->compiler.compileBranch(instr.trueBranch());
-    llvm::BasicBlock *falsy = this->compiler.compileBranch(instr.falseBranch());
+                         uint16_t address, const Core::Instruction &instr) {
+    uint16_t nextAddr = static_cast<uint16_t>(address + instr.operandSize() + 1);
+    llvm::BasicBlock *truthy = this->compiler.compileBranch(instr.destinationAddress(nextAddr));
+    llvm::BasicBlock *falsy = this->compiler.compileBranch(nextAddr);
 
     this->conditionalBranch(b, flag, expect, truthy, falsy);
   }
@@ -634,8 +634,8 @@ InstructionTranslator::InstructionTranslator(FunctionCompiler &compiler, llvm::F
 }
 
 llvm::BasicBlock *InstructionTranslator::translate(Builder &b, uint16_t address,
-                                                   const Analysis::Branch::Instruction &instr) {
-  Impl(this->m_compiler, this->m_func).translate(b, address, instr);
+                                                   const Core::Instruction &instr) {
+  Impl(this->m_compiler, this->m_func).translateAny(b, address, instr);
   return b.GetInsertBlock();
 }
 
@@ -1,5 +1,7 @@
 ﻿#include <interpret/core_interpret.hpp>
 
+#include <interpret/hookpolicy.hpp>
+#include <interpret/lazyflags.hpp>
 #include <core/disassembler.hpp>
 #include <functional>
 
@@ -9,6 +11,7 @@ public:
   Cpu::State &state;
   Cpu::Memory::Ptr mem;
   Core::Disassembler *disasm;
+  Interpret::LazyFlags flags;
 
   InterpretCoreImpl(Interpret::Core *parent, Cpu::State &state, const Cpu::Memory::Ptr &mem)
     : core(parent), state(state), mem(mem) {
@@ -20,56 +23,82 @@ public:
   }
 
   int run(uint16_t address, int cycles) {
+    Cpu::Hook *hook = this->core->hook();
+    if (hook) return this->run(address, cycles, Interpret::CallHook(hook));
+    return this->run(address, cycles, Interpret::NoHook(hook));
+  }
+
+  /**
+   * Runs the guest for \a cycles from \a address on.  The \a hook policy is
+   * fixed for the whole run, so a run without a hook has no checks for it.
+   */
+  template<typename Hook>
+  int run(uint16_t address, int cycles, Hook hook) {
     this->disasm->setPosition(address);
+    this->flags.load(this->state.p);
+
+    if (this->state.interrupts) this->servicePending();
 
     while (cycles > 0) {
-      cycles -= this->step();
+      cycles -= this->step(hook);
+      if (this->state.interrupts) this->servicePending();
     }
 
     this->state.pc = static_cast<uint16_t>(this->disasm->position());
+    this->syncFlags();
     return cycles;
   }
 
+  /** Evaluates the lazy flags into the PSW, so it can be observed. */
+  void syncFlags() {
+    this->state.p = this->flags.apply(this->state.p);
+  }
+
+  /** Takes a pending interrupt, if any, before the next instruction. */
+  void servicePending() {
+    this->state.pc = static_cast<uint16_t>(this->disasm->position());
+    this->syncFlags(); // The interrupt pushes the PSW.
+    this->core->servicePending(); // Calls jump() if it took one.
+  }
+
   /** Executes the next instruction. */
   int step() {
     Cpu::Hook *hook = this->core->hook();
+    if (hook) return this->step(Interpret::CallHook(hook));
+    return this->step(Interpret::NoHook(hook));
+  }
+
+  /** Executes the next instruction, and passes it to the \a hook policy. */
+  template<typename Hook>
+  int step(Hook hook) {
     Core::Instruction instr = this->disasm->next();
 
-    if (hook) hook->beforeInstruction(instr, this->state);
+    if (Hook::enabled) {
+      this->syncFlags();
+      hook.beforeInstruction(instr, this->state);
+      this->flags.load(this->state.p);
+    }
+
     this->state.pc = static_cast<uint16_t>(this->disasm->position());
     this->execute(instr);
 
-    if (hook) hook->afterInstruction(instr, this->state);
+    if (Hook::enabled) {
+      this->syncFlags();
+      hook.afterInstruction(instr, this->state);
+      this->flags.load(this->state.p);
+    }
+
     return instr.cycles;
   }
 
   /** Updates the Negative and Zero flags, and returns \a value. */
   uint8_t setNz(uint8_t value) {
-    this->state.setFlag(Cpu::Flag::Negative, value >= 0x80);
-    this->state.setFlag(Cpu::Flag::Zero, value == 0);
-    return value;
-  }
-
-  /** Updates the Carry flag and passes on to \c setNz. */
-  uint8_t setNzc(uint16_t value) {
-    this->state.setFlag(Cpu::Flag::Carry, value > 0xFF);
-    return this->setNz(static_cast<uint8_t>(value));
-  }
-
-  /**
-   * Updates the Overflow flag from the addition or substraction of \a left
-   * and \a right, with the result being \a value.  Passes on to \c setNzc.
-   */
-  uint8_t setNvzc(uint8_t left, uint8_t right, uint16_t value) {
-    // This is how the 6502 calculates the overflow bit:
-    uint8_t isOverflow = ~(left ^ right) & (left ^ value) & 0x80;
-    this->state.setFlag(Cpu::Flag::Overflow, isOverflow != 0);
-    return this->setNzc(value);
+    return this->flags.setNz(value);
   }
 
   /** Compares the value of \a to \a op. */
   void compare(uint8_t reg, uint8_t op) {
-    this->state.setFlag(Cpu::Flag::Carry, reg >= op);
+    this->flags.setCarry(reg >= op);
     this->setNz(reg - op);
   }
 
@@ -135,7 +164,7 @@ public:
     case Instruction::X: return this->state.x;
     case Instruction::Y: return this->state.y;
     case Instruction::S: return this->state.s;
-    case Instruction::P: return this->state.p;
+    case Instruction::P: return this->flags.apply(this->state.p);
     case Instruction::Imm:
     case Instruction::Imp:
     case Instruction::Rel:
@@ -169,6 +198,7 @@ public:
       break;
     case Instruction::P:
       this->state.p = value;
+      this->flags.load(value);
       break;
     case Instruction::Imm:
     case Instruction::Imp:
@@ -207,7 +237,8 @@ public:
       this->state.s = proc(this->state.s);
       break;
     case Instruction::P:
-      this->state.p = proc(this->state.p);
+      this->state.p = proc(this->flags.apply(this->state.p));
+      this->flags.load(this->state.p);
       break;
     case Instruction::Imm:
       this->state.a = proc(static_cast<uint8_t>(addr));
@@ -236,8 +267,8 @@ public:
     uint16_t right = static_cast<uint16_t>(right8);
 
     // Adjust by carry
-    uint16_t c = this->state.hasFlag(Cpu::Flag::Carry) ? 1 : 0;
-    this->state.a = this->setNvzc(left, right, left + right + c);
+    uint16_t c = this->flags.c;
+    this->state.a = this->flags.setNvzc(left, right, left + right + c);
   }
 
   /** Executes the \a instr in the context of the guest CPU. */
@@ -254,46 +285,47 @@ public:
       break;
     case Instruction::ASL:
       this->rmw(instr, [this](uint8_t v) {
-        this->state.setFlag(Flag::Carry, v >= 0x80);
+        this->flags.setCarry(v >= 0x80);
         return this->setNz(v << 1);
       });
       break;
     case Instruction::BCC:
-      this->branchIf(instr.op8, !this->state.hasFlag(Flag::Carry));
+      this->branchIf(instr.op8, !this->flags.carry());
       break;
     case Instruction::BCS:
-      this->branchIf(instr.op8, this->state.hasFlag(Flag::Carry));
+      this->branchIf(instr.op8, this->flags.carry());
       break;
     case Instruction::BEQ:
-      this->branchIf(instr.op8, this->state.hasFlag(Flag::Zero));
+      this->branchIf(instr.op8, this->flags.zero());
       break;
     case Instruction::BIT: {
       uint8_t value = this->read(instr);
-      this->state.setFlag(Flag::Zero, (this->state.a & value) == 0);
-      this->state.setFlag(Flag::Overflow, (value & (1 << 6)) != 0);
-      this->state.setFlag(Flag::Negative, (value & (1 << 7)) != 0);
+      this->flags.z = this->state.a & value;
+      this->flags.n = value;
+      this->flags.setOverflow((value & (1 << 6)) != 0);
       break;
     }
     case Instruction::BMI:
-      this->branchIf(instr.op8, this->state.hasFlag(Flag::Negative));
+      this->branchIf(instr.op8, this->flags.negative());
       break;
     case Instruction::BNE:
-      this->branchIf(instr.op8, !this->state.hasFlag(Flag::Zero));
+      this->branchIf(instr.op8, !this->flags.zero());
       break;
     case Instruction::BPL:
-      this->branchIf(instr.op8, !this->state.hasFlag(Flag::Negative));
+      this->branchIf(instr.op8, !this->flags.negative());
       break;
     case Instruction::BRK:
+      this->syncFlags();
       this->core->interrupt(Cpu::Break, true);
       break;
     case Instruction::BVC:
-      this->branchIf(instr.op8, !this->state.hasFlag(Flag::Overflow));
+      this->branchIf(instr.op8, !this->flags.overflow());
       break;
     case Instruction::BVS:
-      this->branchIf(instr.op8, this->state.hasFlag(Flag::Overflow));
+      this->branchIf(instr.op8, this->flags.overflow());
       break;
     case Instruction::CLC:
-      this->state.setFlag(Flag::Carry, false);
+      this->flags.setCarry(false);
       break;
     case Instruction::CLD:
       this->state.setFlag(Flag::Decimal, false);
@@ -302,7 +334,7 @@ public:
       this->state.setFlag(Flag::Interrupt, false);
       break;
     case Instruction::CLV:
-      this->state.setFlag(Flag::Overflow, false);
+      this->flags.setOverflow(false);
       break;
     case Instruction::CMP:
       this->compare(this->state.a, this->read(instr));
@@ -344,7 +376,7 @@ public:
       break;
     case Instruction::LSR:
       this->rmw(instr, [this](uint8_t v) {
-        this->state.setFlag(Flag::Carry, (v & 1) == 1);
+        this->flags.setCarry((v & 1) == 1);
         return this->setNz(v >> 1);
       });
       break;
@@ -356,7 +388,7 @@ public:
       this->core->push(this->state.a);
       break;
     case Instruction::PHP: {
-      uint8_t psw = this->state.p | static_cast<uint8_t>(Flag::Break) | static_cast<uint8_t>(Flag::AlwaysOne);
+      uint8_t psw = this->flags.apply(this->state.p) | static_cast<uint8_t>(Flag::Break) | static_cast<uint8_t>(Flag::AlwaysOne);
       this->core->push(psw);
       break;
     }
@@ -365,23 +397,25 @@ public:
       break;
     case Instruction::PLP:
       this->state.p = this->core->pull();
+      this->flags.load(this->state.p);
       break;
     case Instruction::ROL:
       this->rmw(instr, [this](uint8_t v) {
-        uint8_t c = this->state.hasFlag(Flag::Carry) ? 1 : 0;
-        this->state.setFlag(Flag::Carry, v >= 0x80);
+        uint8_t c = this->flags.c;
+        this->flags.setCarry(v >= 0x80);
         return this->setNz((v << 1) | c);
       });
       break;
     case Instruction::ROR:
       this->rmw(instr, [this](uint8_t v) {
-        uint8_t c = this->state.hasFlag(Flag::Carry) ? 0x80 : 0;
-        this->state.setFlag(Flag::Carry, (v & 1) == 1);
+        uint8_t c = this->flags.c << 7;
+        this->flags.setCarry((v & 1) == 1);
         return this->setNz((v >> 1) | c);
       });
       break;
     case Instruction::RTI:
       this->state.p = this->core->pull();
+      this->flags.load(this->state.p);
       this->jump(this->core->pull16());
       break;
     case Instruction::RTS:
@@ -392,7 +426,7 @@ public:
       this->adc(this->read(instr) ^ 0xFF);
       break;
     case Instruction::SEC:
-      this->state.setFlag(Flag::Carry, true);
+      this->flags.setCarry(true);
       break;
     case Instruction::SED:
       this->state.setFlag(Flag::Decimal, true);
@@ -445,8 +479,10 @@ Core::~Core() {
 }
 
 void Core::step() {
+  this->impl->flags.load(this->m_state.p);
   this->impl->step();
   this->impl->state.pc = static_cast<uint16_t>(this->impl->disasm->position());
+  this->impl->syncFlags();
 }
 
 int Core::run(int cycles) {
@@ -459,7 +495,9 @@ void Core::jump(uint16_t address) {
 }
 
 void Core::execute(const ::Core::Instruction &instruction) {
+  this->impl->flags.load(this->m_state.p);
   this->impl->execute(instruction);
+  this->impl->syncFlags();
 }
 
 }
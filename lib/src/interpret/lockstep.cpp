@@ -0,0 +1,859 @@
+#include <interpret/lockstep.hpp>
+#include <interpret/lazyflags.hpp>
+
+#include <core/instruction.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+using Core::Instruction;
+using Cpu::Flag;
+
+static constexpr int RAM_SIZE = Cpu::Memory::RAM_SIZE;
+static constexpr int RAM_MASK = RAM_SIZE - 1;
+
+/** Writing the page number to this address copies it into the OAM. */
+static constexpr uint16_t OAM_DMA = 0x4014;
+
+/** Start of the cartridge ROM. */
+static constexpr uint16_t ROM_BEGIN = 0x8000;
+
+/** Position of lanes which don't run, past all addresses. */
+static constexpr int32_t NO_POSITION = 0x10000;
+
+static constexpr uint8_t flag(Flag f)
+{ return static_cast<uint8_t>(f); }
+}
+
+/** Interface of the lanes, for each width. */
+class LockStepImpl {
+public:
+  virtual ~LockStepImpl() { }
+
+  virtual int width() const = 0;
+  virtual Cpu::State state(int lane) const = 0;
+  virtual void setState(int lane, const Cpu::State &state) = 0;
+  virtual void raise(int lane, Cpu::Interrupt intr) = 0;
+  virtual void run(int cycles) = 0;
+
+  int lanes = 0;
+  uint64_t instructions = 0;
+  uint64_t dispatches = 0;
+};
+
+/**
+ * The CPUs of \a W lanes.  All lane loops run over the full width, with
+ * lanes not executing the current instruction masked off, so the compiler
+ * turns them into vector instructions.  Lanes past \c lanes are never active.
+ *
+ * The flags are lazy like in \c Interpret::LazyFlags, but the Overflow flag
+ * is kept as is, as it's cheaper to compute for all lanes than to keep the
+ * operands around.
+ */
+template<int W>
+class LockStepLanes : public LockStepImpl {
+public:
+  Cpu::Memory *mems[W] = { };
+  uint64_t tags[W] = { }; ///< Memory tag of each lane, as of its last write
+
+  alignas(64) uint8_t ram[RAM_SIZE][W]; ///< Lane-interleaved RAM
+
+  alignas(64) uint8_t a[W] = { };
+  alignas(64) uint8_t x[W] = { };
+  alignas(64) uint8_t y[W] = { };
+  alignas(64) uint8_t s[W] = { };
+  alignas(64) uint8_t p[W] = { }; ///< PSW, except for the lazy flags
+  alignas(64) uint8_t n[W] = { }; ///< Negative if bit 7 is set
+  alignas(64) uint8_t z[W] = { }; ///< Zero if this is \c 0
+  alignas(64) uint8_t c[W] = { }; ///< Carry, \c 0 or \c 1
+  alignas(64) uint8_t v[W] = { }; ///< Overflow, \c 0 or the flag itself
+  alignas(64) uint8_t mask[W] = { }; ///< \c 0xFF if the lane executes the current instruction
+
+  uint16_t pc[W] = { };
+  int32_t cycles[W] = { };
+  uint8_t interrupts[W] = { };
+
+  LockStepLanes(const std::vector<Cpu::Memory *> &memories) {
+    this->lanes = static_cast<int>(memories.size());
+
+    for (int l = 0; l < this->lanes; l++) {
+      this->mems[l] = memories[l];
+      this->setState(l, Cpu::State());
+    }
+  }
+
+  int width() const override {
+    return W;
+  }
+
+  Cpu::State state(int lane) const override {
+    Cpu::State state;
+    state.a = this->a[lane];
+    state.x = this->x[lane];
+    state.y = this->y[lane];
+    state.s = this->s[lane];
+    state.p = this->psw(lane);
+    state.cycles = this->cycles[lane];
+    state.pc = this->pc[lane];
+    state.interrupts = this->interrupts[lane];
+    return state;
+  }
+
+  void setState(int lane, const Cpu::State &state) override {
+    this->a[lane] = state.a;
+    this->x[lane] = state.x;
+    this->y[lane] = state.y;
+    this->s[lane] = state.s;
+    this->p[lane] = state.p;
+    this->loadFlags(lane, state.p);
+    this->cycles[lane] = state.cycles;
+    this->pc[lane] = state.pc;
+    this->interrupts[lane] = state.interrupts;
+  }
+
+  void raise(int lane, Cpu::Interrupt intr) override {
+    this->interrupts[lane] |= static_cast<uint8_t>(1 << intr);
+  }
+
+  void run(int cycles) override {
+    for (int l = 0; l < this->lanes; l++) {
+      this->copyRamIn(l);
+      this->tags[l] = this->mems[l]->tag();
+      this->cycles[l] = cycles;
+      if (this->interrupts[l]) this->servicePending(l);
+    }
+
+    while (true) {
+      // The lanes furthest behind go first, so diverged lanes catch up.
+      // Lanes which are done, or not in use, have no cycles left.
+      alignas(64) int32_t position[W];
+      int32_t lowest = NO_POSITION;
+      for (int l = 0; l < W; l++) {
+        position[l] = (this->cycles[l] > 0) ? this->pc[l] : NO_POSITION;
+        lowest = std::min(lowest, position[l]);
+      }
+
+      if (lowest == NO_POSITION) break;
+
+      int leader = 0;
+      while (position[leader] != lowest) leader++;
+
+      uint16_t address = static_cast<uint16_t>(lowest);
+      Instruction instr = this->fetch(leader, address);
+      uint16_t next = static_cast<uint16_t>(address + 1 + instr.operandSize());
+
+      this->join(position, leader, address, instr.operandSize() + 1);
+
+      int active = 0;
+      for (int l = 0; l < W; l++) {
+        this->pc[l] = this->mask[l] ? next : this->pc[l];
+        active += this->mask[l] & 1;
+      }
+
+      this->execute(instr, next);
+
+      uint8_t pending = 0;
+      for (int l = 0; l < W; l++) {
+        this->cycles[l] -= this->mask[l] ? instr.cycles : 0;
+        pending |= this->interrupts[l] & this->mask[l];
+      }
+
+      if (pending) {
+        for (int l = 0; l < this->lanes; l++) {
+          if (this->mask[l] && this->interrupts[l]) this->servicePending(l);
+        }
+      }
+
+      this->instructions += active;
+      this->dispatches++;
+    }
+
+    for (int l = 0; l < this->lanes; l++) {
+      this->copyRamOut(l);
+    }
+  }
+
+  /**
+   * Masks on the lanes at \a position \a address which see the same
+   * \a length bytes of code there as the \a leader.
+   */
+  void join(const int32_t *position, int leader, uint16_t address, int length) {
+    if (address >= ROM_BEGIN) {
+      uint64_t tag = this->tags[leader];
+      for (int l = 0; l < W; l++) this->mask[l] = (position[l] == address && this->tags[l] == tag) ? 0xFF : 0x00;
+    } else if (address < Cpu::Memory::RAM_BARRIER) {
+      for (int l = 0; l < W; l++) this->mask[l] = (position[l] == address) ? 0xFF : 0x00;
+
+      for (int i = 0; i < length; i++) {
+        const uint8_t *cell = this->ram[(address + i) & RAM_MASK];
+        for (int l = 0; l < W; l++) this->mask[l] &= (cell[l] == cell[leader]) ? 0xFF : 0x00;
+      }
+    } else { // Run code in I/O or cartridge RAM on one lane at a time.
+      for (int l = 0; l < W; l++) this->mask[l] = (l == leader) ? 0xFF : 0x00;
+    }
+  }
+
+  void copyRamIn(int lane) {
+    const uint8_t *from = this->mems[lane]->ram();
+    for (int i = 0; i < RAM_SIZE; i++) this->ram[i][lane] = from[i];
+  }
+
+  void copyRamOut(int lane) {
+    uint8_t *to = this->mems[lane]->ram();
+    for (int i = 0; i < RAM_SIZE; i++) to[i] = this->ram[i][lane];
+  }
+
+  //// Single lanes
+
+  uint8_t read(int lane, uint16_t address) {
+    if (address < Cpu::Memory::RAM_BARRIER) return this->ram[address & RAM_MASK][lane];
+    return this->mems[lane]->read(address);
+  }
+
+  void write(int lane, uint16_t address, uint8_t value) {
+    if (address < Cpu::Memory::RAM_BARRIER) {
+      this->ram[address & RAM_MASK][lane] = value;
+      return;
+    }
+
+    if (address == OAM_DMA) this->copyRamOut(lane); // The DMA reads the RAM of the memory.
+    this->mems[lane]->write(address, value);
+    this->tags[lane] = this->mems[lane]->tag();
+  }
+
+  /** Like \c Cpu::Memory::read16(), wrapping around in the page. */
+  uint16_t read16(int lane, uint16_t address) {
+    uint16_t high = (address & 0xFF00) | ((address + 1) & 0x00FF);
+    return static_cast<uint16_t>(this->read(lane, address) | (this->read(lane, high) << 8));
+  }
+
+  Instruction fetch(int lane, uint16_t address) {
+    Instruction instr = Instruction::decode(this->read(lane, address));
+
+    switch (instr.operandSize()) {
+    case 1:
+      instr.op8 = this->read(lane, static_cast<uint16_t>(address + 1));
+      break;
+    case 2:
+      instr.op16 = this->read16(lane, static_cast<uint16_t>(address + 1));
+      break;
+    }
+
+    return instr;
+  }
+
+  /** The PSW of \a lane with the lazy flags evaluated. */
+  uint8_t psw(int lane) const {
+    uint8_t value = (this->p[lane] & ~Interpret::LazyFlags::MASK) | (this->n[lane] & 0x80) | this->c[lane] | this->v[lane];
+    return value | (this->z[lane] ? 0 : flag(Flag::Zero));
+  }
+
+  void loadFlags(int lane, uint8_t psw) {
+    this->n[lane] = psw & flag(Flag::Negative);
+    this->z[lane] = (psw & flag(Flag::Zero)) ? 0 : 1;
+    this->c[lane] = psw & flag(Flag::Carry);
+    this->v[lane] = psw & flag(Flag::Overflow);
+  }
+
+  void push(int lane, uint8_t value) {
+    this->ram[Cpu::STACK_BASE + this->s[lane]][lane] = value;
+    this->s[lane]--;
+  }
+
+  /** Like \c Cpu::Base::servicePending(). */
+  void servicePending(int lane) {
+    static constexpr Cpu::Interrupt priority[] = { Cpu::NonMaskable, Cpu::Service };
+
+    for (Cpu::Interrupt intr : priority) {
+      uint8_t line = static_cast<uint8_t>(1 << intr);
+      if (!(this->interrupts[lane] & line)) continue;
+      if (Cpu::isInterruptMaskable(intr) && (this->p[lane] & flag(Flag::Interrupt))) continue;
+
+      this->interrupts[lane] &= ~line;
+      this->interrupt(lane, intr);
+      return;
+    }
+  }
+
+  /** Like \c Cpu::Base::interrupt() when forced. */
+  void interrupt(int lane, Cpu::Interrupt intr) {
+    uint8_t psw = this->psw(lane) | flag(Flag::AlwaysOne);
+
+    if (intr == Cpu::Break)
+      psw |= flag(Flag::Break);
+    else
+      psw &= ~flag(Flag::Break);
+
+    this->push(lane, static_cast<uint8_t>(this->pc[lane] >> 8));
+    this->push(lane, static_cast<uint8_t>(this->pc[lane]));
+    this->push(lane, psw);
+
+    this->p[lane] |= flag(Flag::Interrupt);
+    this->pc[lane] = this->read16(lane, static_cast<uint16_t>(Cpu::interruptVectorAddress(intr)));
+  }
+
+  //// All lanes
+
+  /** Sets \a to \a from in all active lanes. */
+  void blend(uint8_t *to, const uint8_t *from) {
+    for (int l = 0; l < W; l++) to[l] = (to[l] & ~this->mask[l]) | (from[l] & this->mask[l]);
+  }
+
+  void fill(uint8_t *to, uint8_t value) {
+    for (int l = 0; l < W; l++) to[l] = (to[l] & ~this->mask[l]) | (value & this->mask[l]);
+  }
+
+  void setNz(const uint8_t *value) {
+    this->blend(this->n, value);
+    this->blend(this->z, value);
+  }
+
+  /** Sets the PSW of all active lanes to \a value, like \c PLP. */
+  void setPsw(const uint8_t *value) {
+    this->blend(this->p, value);
+
+    alignas(64) uint8_t zero[W], carry[W], overflow[W];
+    for (int l = 0; l < W; l++) {
+      zero[l] = (value[l] & flag(Flag::Zero)) ? 0 : 1;
+      carry[l] = value[l] & flag(Flag::Carry);
+      overflow[l] = value[l] & flag(Flag::Overflow);
+    }
+
+    this->blend(this->n, value);
+    this->blend(this->z, zero);
+    this->blend(this->c, carry);
+    this->blend(this->v, overflow);
+  }
+
+  /** Are the \a addresses of all active lanes in RAM? */
+  bool inRam(const uint16_t *addresses) const {
+    uint8_t outside = 0;
+    for (int l = 0; l < W; l++) outside |= this->mask[l] & ((addresses[l] >= Cpu::Memory::RAM_BARRIER) ? 0xFF : 0);
+    return outside == 0;
+  }
+
+  /** Resolves the memory operand of \a instr for each lane into \a out. */
+  void resolve(const Instruction &instr, uint16_t *out) {
+    switch (instr.addressing) {
+    default: // Ignore modes that don't translate to memory.
+      for (int l = 0; l < W; l++) out[l] = 0;
+      break;
+    case Instruction::Zp:
+      for (int l = 0; l < W; l++) out[l] = instr.op8;
+      break;
+    case Instruction::ZpX:
+      for (int l = 0; l < W; l++) out[l] = (instr.op8 + this->x[l]) & 0x00FF;
+      break;
+    case Instruction::ZpY:
+      for (int l = 0; l < W; l++) out[l] = (instr.op8 + this->y[l]) & 0x00FF;
+      break;
+    case Instruction::Abs:
+      for (int l = 0; l < W; l++) out[l] = instr.op16;
+      break;
+    case Instruction::AbsX:
+      for (int l = 0; l < W; l++) out[l] = static_cast<uint16_t>(instr.op16 + this->x[l]);
+      break;
+    case Instruction::AbsY:
+      for (int l = 0; l < W; l++) out[l] = static_cast<uint16_t>(instr.op16 + this->y[l]);
+      break;
+    case Instruction::Ind:
+      for (int l = 0; l < W; l++) out[l] = this->mask[l] ? this->read16(l, instr.op16) : 0;
+      break;
+    case Instruction::IndX:
+      // The pointers are in the zero page, which is always in RAM.
+      for (int l = 0; l < W; l++) {
+        uint8_t pointer = instr.op8 + this->x[l];
+        out[l] = this->ram[pointer][l] | (this->ram[static_cast<uint8_t>(pointer + 1)][l] << 8);
+      }
+      break;
+    case Instruction::IndY:
+      for (int l = 0; l < W; l++) {
+        uint16_t base = this->ram[instr.op8][l] | (this->ram[static_cast<uint8_t>(instr.op8 + 1)][l] << 8);
+        out[l] = static_cast<uint16_t>(base + this->y[l]);
+      }
+      break;
+    }
+  }
+
+  void readMemory(const uint16_t *addresses, uint8_t *out) {
+    if (this->inRam(addresses)) {
+      for (int l = 0; l < W; l++) out[l] = this->ram[addresses[l] & RAM_MASK][l];
+    } else {
+      for (int l = 0; l < W; l++) out[l] = this->mask[l] ? this->read(l, addresses[l]) : 0;
+    }
+  }
+
+  void writeMemory(const uint16_t *addresses, const uint8_t *value) {
+    if (this->inRam(addresses)) {
+      for (int l = 0; l < W; l++) {
+        uint8_t &cell = this->ram[addresses[l] & RAM_MASK][l];
+        cell = (cell & ~this->mask[l]) | (value[l] & this->mask[l]);
+      }
+    } else {
+      for (int l = 0; l < W; l++) {
+        if (this->mask[l]) this->write(l, addresses[l], value[l]);
+      }
+    }
+  }
+
+  /** Reads the byte \a instr is pointing at, be it a memory address or a register. */
+  void read(const Instruction &instr, uint8_t *out) {
+    switch (instr.addressing) {
+    case Instruction::Acc: this->copy(out, this->a); break;
+    case Instruction::X: this->copy(out, this->x); break;
+    case Instruction::Y: this->copy(out, this->y); break;
+    case Instruction::S: this->copy(out, this->s); break;
+    case Instruction::P:
+      for (int l = 0; l < W; l++) out[l] = this->psw(l);
+      break;
+    case Instruction::Imm:
+    case Instruction::Imp:
+    case Instruction::Rel:
+      for (int l = 0; l < W; l++) out[l] = instr.op8;
+      break;
+    default: { // Resolve and read from memory.
+      alignas(64) uint16_t addresses[W];
+      this->resolve(instr, addresses);
+      this->readMemory(addresses, out);
+      break;
+    }
+    }
+  }
+
+  /** Writes the \a value into what \a instr is pointing at. */
+  void write(const Instruction &instr, const uint8_t *value) {
+    switch (instr.addressing) {
+    case Instruction::Acc: this->blend(this->a, value); break;
+    case Instruction::X: this->blend(this->x, value); break;
+    case Instruction::Y: this->blend(this->y, value); break;
+    case Instruction::S: this->blend(this->s, value); break;
+    case Instruction::P: this->setPsw(value); break;
+    case Instruction::Imm:
+    case Instruction::Imp:
+    case Instruction::Rel:
+      throw std::runtime_error("Can't write to Imm/Imp/Rel addressing instruction");
+    default: { // Resolve and write to memory.
+      alignas(64) uint16_t addresses[W];
+      this->resolve(instr, addresses);
+      this->writeMemory(addresses, value);
+      break;
+    }
+    }
+  }
+
+  /**
+   * Reads the byte \a instr is pointing at, passes it to \a proc for each
+   * lane, and writes the result back into the same place.
+   */
+  template<typename Proc>
+  void rmw(const Instruction &instr, Proc proc) {
+    alignas(64) uint8_t value[W], result[W];
+
+    switch (instr.addressing) {
+    case Instruction::Rel:
+    case Instruction::Imp:
+      throw std::runtime_error("Can't RMW on a Rel/Imp adressing instruction");
+    case Instruction::Acc:
+    case Instruction::X:
+    case Instruction::Y:
+    case Instruction::S:
+    case Instruction::P:
+    case Instruction::Imm:
+      this->read(instr, value);
+      for (int l = 0; l < W; l++) result[l] = proc(l, value[l]);
+      if (instr.addressing == Instruction::Imm) this->blend(this->a, result);
+      else this->write(instr, result);
+      break;
+    default: { // Read and write to memory, resolving the address only once.
+      alignas(64) uint16_t addresses[W];
+      this->resolve(instr, addresses);
+      this->readMemory(addresses, value);
+      for (int l = 0; l < W; l++) result[l] = proc(l, value[l]);
+      this->writeMemory(addresses, result);
+      break;
+    }
+    }
+  }
+
+  void copy(uint8_t *to, const uint8_t *from) {
+    for (int l = 0; l < W; l++) to[l] = from[l];
+  }
+
+  /** Shared implementation for ADC and SBC instructions. */
+  void adc(const uint8_t *right) {
+    alignas(64) uint8_t result[W], carry[W], overflow[W];
+
+    for (int l = 0; l < W; l++) {
+      unsigned sum = this->a[l] + right[l] + this->c[l];
+      result[l] = static_cast<uint8_t>(sum);
+      carry[l] = static_cast<uint8_t>(sum >> 8);
+      overflow[l] = (~(this->a[l] ^ right[l]) & (this->a[l] ^ result[l]) & 0x80) >> 1;
+    }
+
+    this->blend(this->a, result);
+    this->blend(this->c, carry);
+    this->blend(this->v, overflow);
+    this->setNz(result);
+  }
+
+  /** Compares the value of \a reg to \a op. */
+  void compare(const uint8_t *reg, const uint8_t *op) {
+    alignas(64) uint8_t result[W], carry[W];
+
+    for (int l = 0; l < W; l++) {
+      carry[l] = (reg[l] >= op[l]) ? 1 : 0;
+      result[l] = reg[l] - op[l];
+    }
+
+    this->blend(this->c, carry);
+    this->setNz(result);
+  }
+
+  /** Loads \a value into \a reg, updating the Negative and Zero flags. */
+  void load(uint8_t *reg, const uint8_t *value) {
+    this->blend(reg, value);
+    this->setNz(value);
+  }
+
+  /** Moves the active lanes for which \a taken is \c true to \a target. */
+  template<typename Cond>
+  void branchIf(uint16_t target, Cond taken) {
+    for (int l = 0; l < W; l++) {
+      if (this->mask[l] && taken(l)) this->pc[l] = target;
+    }
+  }
+
+  void jump(uint16_t target) {
+    for (int l = 0; l < W; l++) {
+      if (this->mask[l]) this->pc[l] = target;
+    }
+  }
+
+  void push(const uint8_t *value) {
+    for (int l = 0; l < W; l++) {
+      uint8_t &cell = this->ram[Cpu::STACK_BASE + this->s[l]][l];
+      cell = (cell & ~this->mask[l]) | (value[l] & this->mask[l]);
+      this->s[l] -= this->mask[l] & 1;
+    }
+  }
+
+  void push16(uint16_t value) {
+    alignas(64) uint8_t high[W], low[W];
+
+    for (int l = 0; l < W; l++) {
+      high[l] = static_cast<uint8_t>(value >> 8);
+      low[l] = static_cast<uint8_t>(value);
+    }
+
+    this->push(high);
+    this->push(low);
+  }
+
+  void pull(uint8_t *out) {
+    for (int l = 0; l < W; l++) {
+      this->s[l] += this->mask[l] & 1;
+      out[l] = this->ram[Cpu::STACK_BASE + this->s[l]][l];
+    }
+  }
+
+  void pull16(uint16_t *out) {
+    alignas(64) uint8_t low[W], high[W];
+    this->pull(low);
+    this->pull(high);
+    for (int l = 0; l < W; l++) out[l] = static_cast<uint16_t>(low[l] | (high[l] << 8));
+  }
+
+  /** Executes the \a instr on all active lanes, with \a next being the address after it. */
+  void execute(const Instruction &instr, uint16_t next) {
+    alignas(64) uint8_t value[W];
+    uint16_t target = static_cast<uint16_t>(next + instr.ops8);
+
+    switch (instr.command) {
+    case Instruction::ADC:
+      this->read(instr, value);
+      this->adc(value);
+      break;
+    case Instruction::AND:
+      this->read(instr, value);
+      for (int l = 0; l < W; l++) value[l] &= this->a[l];
+      this->load(this->a, value);
+      break;
+    case Instruction::ASL:
+      this->rmw(instr, [this](int l, uint8_t v) {
+        this->c[l] = (this->c[l] & ~this->mask[l]) | ((v >> 7) & this->mask[l]);
+        uint8_t result = static_cast<uint8_t>(v << 1);
+        this->n[l] = this->z[l] = (this->n[l] & ~this->mask[l]) | (result & this->mask[l]);
+        return result;
+      });
+      break;
+    case Instruction::BCC:
+      this->branchIf(target, [this](int l) { return !this->c[l]; });
+      break;
+    case Instruction::BCS:
+      this->branchIf(target, [this](int l) { return this->c[l]; });
+      break;
+    case Instruction::BEQ:
+      this->branchIf(target, [this](int l) { return !this->z[l]; });
+      break;
+    case Instruction::BIT: {
+      alignas(64) uint8_t zero[W], overflow[W];
+      this->read(instr, value);
+
+      for (int l = 0; l < W; l++) {
+        zero[l] = this->a[l] & value[l];
+        overflow[l] = value[l] & flag(Flag::Overflow);
+      }
+
+      this->blend(this->z, zero);
+      this->blend(this->n, value);
+      this->blend(this->v, overflow);
+      break;
+    }
+    case Instruction::BMI:
+      this->branchIf(target, [this](int l) { return this->n[l] & 0x80; });
+      break;
+    case Instruction::BNE:
+      this->branchIf(target, [this](int l) { return this->z[l]; });
+      break;
+    case Instruction::BPL:
+      this->branchIf(target, [this](int l) { return !(this->n[l] & 0x80); });
+      break;
+    case Instruction::BRK:
+      for (int l = 0; l < this->lanes; l++) {
+        if (this->mask[l]) this->interrupt(l, Cpu::Break);
+      }
+      break;
+    case Instruction::BVC:
+      this->branchIf(target, [this](int l) { return !this->v[l]; });
+      break;
+    case Instruction::BVS:
+      this->branchIf(target, [this](int l) { return this->v[l]; });
+      break;
+    case Instruction::CLC:
+      this->fill(this->c, 0);
+      break;
+    case Instruction::CLD:
+      for (int l = 0; l < W; l++) this->p[l] &= ~(this->mask[l] & flag(Flag::Decimal));
+      break;
+    case Instruction::CLI:
+      for (int l = 0; l < W; l++) this->p[l] &= ~(this->mask[l] & flag(Flag::Interrupt));
+      break;
+    case Instruction::CLV:
+      this->fill(this->v, 0);
+      break;
+    case Instruction::CMP:
+      this->read(instr, value);
+      this->compare(this->a, value);
+      break;
+    case Instruction::CPX:
+      this->read(instr, value);
+      this->compare(this->x, value);
+      break;
+    case Instruction::CPY:
+      this->read(instr, value);
+      this->compare(this->y, value);
+      break;
+    case Instruction::DEC:
+    case Instruction::DEX:
+    case Instruction::DEY:
+      this->rmw(instr, [this](int l, uint8_t v) {
+        uint8_t result = v - 1;
+        this->n[l] = this->z[l] = (this->n[l] & ~this->mask[l]) | (result & this->mask[l]);
+        return result;
+      });
+      break;
+    case Instruction::EOR:
+      this->read(instr, value);
+      for (int l = 0; l < W; l++) value[l] ^= this->a[l];
+      this->load(this->a, value);
+      break;
+    case Instruction::INC:
+    case Instruction::INX:
+    case Instruction::INY:
+      this->rmw(instr, [this](int l, uint8_t v) {
+        uint8_t result = v + 1;
+        this->n[l] = this->z[l] = (this->n[l] & ~this->mask[l]) | (result & this->mask[l]);
+        return result;
+      });
+      break;
+    case Instruction::JMP:
+      if (instr.addressing == Instruction::Ind) {
+        for (int l = 0; l < this->lanes; l++) {
+          if (this->mask[l]) this->pc[l] = this->read16(l, instr.op16);
+        }
+      } else {
+        this->jump(instr.op16);
+      }
+      break;
+    case Instruction::JSR:
+      this->push16(static_cast<uint16_t>(next - 1));
+      this->jump(instr.op16);
+      break;
+    case Instruction::LDA:
+      this->read(instr, value);
+      this->load(this->a, value);
+      break;
+    case Instruction::LDX:
+      this->read(instr, value);
+      this->load(this->x, value);
+      break;
+    case Instruction::LDY:
+      this->read(instr, value);
+      this->load(this->y, value);
+      break;
+    case Instruction::LSR:
+      this->rmw(instr, [this](int l, uint8_t v) {
+        this->c[l] = (this->c[l] & ~this->mask[l]) | (v & 1 & this->mask[l]);
+        uint8_t result = v >> 1;
+        this->n[l] = this->z[l] = (this->n[l] & ~this->mask[l]) | (result & this->mask[l]);
+        return result;
+      });
+      break;
+    case Instruction::NOP: /* Nothing. */ break;
+    case Instruction::ORA:
+      this->read(instr, value);
+      for (int l = 0; l < W; l++) value[l] |= this->a[l];
+      this->load(this->a, value);
+      break;
+    case Instruction::PHA:
+      this->push(this->a);
+      break;
+    case Instruction::PHP:
+      for (int l = 0; l < W; l++) value[l] = this->psw(l) | flag(Flag::Break) | flag(Flag::AlwaysOne);
+      this->push(value);
+      break;
+    case Instruction::PLA:
+      this->pull(value);
+      this->load(this->a, value);
+      break;
+    case Instruction::PLP:
+      this->pull(value);
+      this->setPsw(value);
+      break;
+    case Instruction::ROL:
+      this->rmw(instr, [this](int l, uint8_t v) {
+        uint8_t result = static_cast<uint8_t>((v << 1) | this->c[l]);
+        this->c[l] = (this->c[l] & ~this->mask[l]) | ((v >> 7) & this->mask[l]);
+        this->n[l] = this->z[l] = (this->n[l] & ~this->mask[l]) | (result & this->mask[l]);
+        return result;
+      });
+      break;
+    case Instruction::ROR:
+      this->rmw(instr, [this](int l, uint8_t v) {
+        uint8_t result = static_cast<uint8_t>((v >> 1) | (this->c[l] << 7));
+        this->c[l] = (this->c[l] & ~this->mask[l]) | (v & 1 & this->mask[l]);
+        this->n[l] = this->z[l] = (this->n[l] & ~this->mask[l]) | (result & this->mask[l]);
+        return result;
+      });
+      break;
+    case Instruction::RTI: {
+      alignas(64) uint16_t address[W];
+      this->pull(value);
+      this->setPsw(value);
+      this->pull16(address);
+      for (int l = 0; l < W; l++) this->pc[l] = this->mask[l] ? address[l] : this->pc[l];
+      break;
+    }
+    case Instruction::RTS: {
+      alignas(64) uint16_t address[W];
+      this->pull16(address);
+      for (int l = 0; l < W; l++) this->pc[l] = this->mask[l] ? static_cast<uint16_t>(address[l] + 1) : this->pc[l];
+      break;
+    }
+    case Instruction::SBC:
+      // Invert using 1s complement, the Carry will then adjust.
+      this->read(instr, value);
+      for (int l = 0; l < W; l++) value[l] ^= 0xFF;
+      this->adc(value);
+      break;
+    case Instruction::SEC:
+      this->fill(this->c, 1);
+      break;
+    case Instruction::SED:
+      for (int l = 0; l < W; l++) this->p[l] |= this->mask[l] & flag(Flag::Decimal);
+      break;
+    case Instruction::SEI:
+      for (int l = 0; l < W; l++) this->p[l] |= this->mask[l] & flag(Flag::Interrupt);
+      break;
+    case Instruction::STA:
+      this->write(instr, this->a);
+      break;
+    case Instruction::STX:
+      this->write(instr, this->x);
+      break;
+    case Instruction::STY:
+      this->write(instr, this->y);
+      break;
+    case Instruction::TAX:
+      this->load(this->x, this->a);
+      break;
+    case Instruction::TAY:
+      this->load(this->y, this->a);
+      break;
+    case Instruction::TSX:
+      this->load(this->x, this->s);
+      break;
+    case Instruction::TXA:
+      this->load(this->a, this->x);
+      break;
+    case Instruction::TXS:
+      this->blend(this->s, this->x);
+      break;
+    case Instruction::TYA:
+      this->load(this->a, this->y);
+      break;
+    default:
+      throw std::runtime_error("Unknown instruction encountered");
+    }
+  }
+};
+
+namespace Interpret {
+LockStep::LockStep(const std::vector<Cpu::Memory *> &memories) {
+  if (memories.empty() || memories.size() > MAX_LANES) {
+    throw std::runtime_error("Lock-step interpreter needs between 1 and 16 lanes");
+  }
+
+  if (memories.size() <= 8)
+    this->impl = new LockStepLanes<8>(memories);
+  else
+    this->impl = new LockStepLanes<16>(memories);
+}
+
+LockStep::~LockStep() {
+  delete this->impl;
+}
+
+int LockStep::lanes() const {
+  return this->impl->lanes;
+}
+
+int LockStep::width() const {
+  return this->impl->width();
+}
+
+Cpu::State LockStep::state(int lane) const {
+  return this->impl->state(lane);
+}
+
+void LockStep::setState(int lane, const Cpu::State &state) {
+  this->impl->setState(lane, state);
+}
+
+void LockStep::raise(int lane, Cpu::Interrupt intr) {
+  this->impl->raise(lane, intr);
+}
+
+void LockStep::run(int cycles) {
+  this->impl->run(cycles);
+}
+
+uint64_t LockStep::instructions() const {
+  return this->impl->instructions;
+}
+
+uint64_t LockStep::dispatches() const {
+  return this->impl->dispatches;
+}
+}
@@ -0,0 +1,810 @@
+#include <interpret/core_threaded.hpp>
+#include <interpret/hookpolicy.hpp>
+#include <interpret/lazyflags.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+// GCC and Clang can take the address of a label.  This lets every handler jump
+// straight to the handler of the next instruction, instead of going through a
+// single, badly predictable, switch.
+#if defined(__GNUC__)
+#define THREADED_COMPUTED_GOTO
+#endif
+
+namespace {
+using Core::Instruction;
+
+/** Pseudo addressing mode of an operand already resolved to a RAM offset. */
+static constexpr uint8_t Ram = Instruction::IndY + 1;
+
+/** Start of the cartridge RAM.  Games may copy code in there. */
+static constexpr uint16_t WRAM_BEGIN = 0x6000;
+
+/** Start of the cartridge ROM. */
+static constexpr uint16_t ROM_BEGIN = 0x8000;
+
+static constexpr int PAGE_SIZE = Cpu::Memory::PAGE_SIZE;
+static constexpr int PAGE_COUNT = 0x10000 / PAGE_SIZE;
+static constexpr int RAM_PAGES = Cpu::Memory::RAM_SIZE / PAGE_SIZE;
+static constexpr int WRAM_PAGES = (ROM_BEGIN - WRAM_BEGIN) / PAGE_SIZE;
+static constexpr int ROM_PAGES = PAGE_COUNT - ROM_BEGIN / PAGE_SIZE;
+
+/** A predecoded instruction. */
+struct Op {
+  const void *handler = nullptr; /// Handler of the command, when using computed goto
+  uint16_t operand = 0; /// Operand, resolved as far as possible
+  Instruction::Command command = Instruction::Unknown;
+  uint8_t mode = Instruction::Imp; /// Addressing mode, or \c Ram
+  uint8_t cycles = 0;
+  uint8_t length = 0; /// Size of the instruction, or \c 0 if it wasn't decoded yet
+};
+
+/**
+ * Predecoded instructions of a page of the cartridge ROM.  Pages are shared
+ * with the cores of forked runners, which may run on other threads.  Once
+ * shared, a page is never written to again.
+ */
+struct RomPage {
+  Op ops[PAGE_SIZE];
+  std::atomic<bool> shared{ false };
+};
+
+/** Predecoded instructions of the cartridge ROM in one banking state. */
+struct Bank {
+  std::shared_ptr<RomPage> pages[ROM_PAGES];
+};
+
+/** Banks by tag. */
+typedef std::unordered_map<uint64_t, Bank> BankMap;
+
+/** Reads and decodes the instruction at \a address. */
+static Instruction fetchInstruction(Cpu::Memory *mem, uint16_t address) {
+  Instruction instr = Instruction::decode(mem->read(address));
+
+  switch (instr.operandSize()) {
+  case 1:
+    instr.op8 = mem->read(static_cast<uint16_t>(address + 1));
+    break;
+  case 2:
+    instr.op16 = static_cast<uint16_t>(mem->read(static_cast<uint16_t>(address + 1)))
+               | static_cast<uint16_t>(mem->read(static_cast<uint16_t>(address + 2)) << 8);
+    break;
+  }
+
+  return instr;
+}
+}
+
+class ThreadedCoreImpl {
+public:
+  Interpret::ThreadedCore *core;
+  Cpu::State &state;
+  Cpu::Memory::Ptr mem;
+  uint8_t *ram;
+  Interpret::LazyFlags flags;
+
+  /** Handlers by command, as set up by \c run(). */
+  const void *const *handlers = nullptr;
+
+  /** Instruction cache by page of the address space, if mapped yet. */
+  Op *pages[PAGE_COUNT] = { };
+
+  /** Instructions in RAM, and a bit mask of the RAM pages in use. */
+  Op ramOps[Cpu::Memory::RAM_SIZE];
+  uint8_t ramCode = 0;
+
+  /** Instructions in the cartridge RAM, and a bit mask of the pages in use. */
+  std::unique_ptr<Op[]> wramOps;
+  uint32_t wramCode = 0;
+
+  /** Instructions in the cartridge ROM by tag. */
+  BankMap banks;
+  Bank *bank = nullptr;
+  uint64_t tag = 0;
+
+  /** Storage for instructions which can't be cached. */
+  Op scratch;
+
+  /** The instruction passed to the hook. */
+  Instruction hooked = Instruction(Instruction::Unknown, Instruction::Imp, 0);
+
+  ThreadedCoreImpl(Interpret::ThreadedCore *parent, Cpu::State &state, const Cpu::Memory::Ptr &mem)
+    : core(parent), state(state), mem(mem), ram(mem->ram())
+  {
+    // The RAM is mirrored four times.  Code on the stack page is never cached,
+    // as the stack is also written by the \c Cpu::Base, behind our back.
+    for (int page = 0; page < Cpu::Memory::RAM_BARRIER / PAGE_SIZE; page++) {
+      int offset = page % RAM_PAGES;
+      if (offset == Cpu::STACK_BASE / PAGE_SIZE) continue;
+      this->pages[page] = this->ramOps + offset * PAGE_SIZE;
+    }
+  }
+
+  int run(int cycles) {
+    Cpu::Hook *hook = this->core->hook();
+    if (hook) return this->run(cycles, Interpret::CallHook(hook));
+    return this->run(cycles, Interpret::NoHook(hook));
+  }
+
+  template<typename Hook>
+  int run(int cycles, Hook hook) {
+    using Cpu::Flag;
+    Cpu::State &state = this->state;
+    uint16_t pc = state.pc;
+    const Op *op;
+
+#define THREADED_COMMANDS(X) \
+  X(Unknown) X(ADC) X(AND) X(ASL) X(BCC) X(BCS) X(BEQ) X(BIT) X(BMI) X(BNE) \
+  X(BPL) X(BRK) X(BVC) X(BVS) X(CLC) X(CLD) X(CLI) X(CLV) X(CMP) X(CPX) \
+  X(CPY) X(DEC) X(DEX) X(DEY) X(EOR) X(INC) X(INX) X(INY) X(JMP) X(JSR) \
+  X(LDA) X(LDX) X(LDY) X(LSR) X(NOP) X(ORA) X(PHA) X(PHP) X(PLA) X(PLP) \
+  X(ROL) X(ROR) X(RTI) X(RTS) X(SBC) X(SEC) X(SED) X(SEI) X(STA) X(STX) \
+  X(STY) X(TAX) X(TAY) X(TSX) X(TXA) X(TXS) X(TYA)
+
+#ifdef THREADED_COMPUTED_GOTO
+#define THREADED_ADDRESS(Cmd) &&handle_##Cmd,
+#define HANDLER(Cmd) handle_##Cmd
+#define GOTO_HANDLER() goto *(Hook::enabled ? table[op->command] : op->handler)
+
+    // Each instantiation has its own handlers.  Only those of the hook-less one
+    // are cached, the others are looked up by command.
+    static const void *const table[] = { THREADED_COMMANDS(THREADED_ADDRESS) };
+    static_assert(sizeof(table) / sizeof(*table) == Instruction::TYA + 1, "Handler table is incomplete");
+
+    if (!Hook::enabled && this->handlers != table) {
+      this->handlers = table;
+      this->invalidate(); // Drop instructions decoded without these handlers.
+    }
+#else
+#define HANDLER(Cmd) case Instruction::Cmd
+#define GOTO_HANDLER() goto dispatch
+#endif
+
+// Fetches the instruction at pc, and runs it.  The cycles are taken right away,
+// as the handler may invalidate the instruction it's running.
+#define DISPATCH() \
+  do { \
+    op = this->fetch(pc); \
+    if (Hook::enabled) this->beforeInstruction(hook, pc, op->length); \
+    pc = static_cast<uint16_t>(pc + op->length); \
+    cycles -= op->cycles; \
+    GOTO_HANDLER(); \
+  } while (0)
+
+// Ends the current instruction, and dispatches the next one.
+#define NEXT() \
+  do { \
+    if (Hook::enabled) this->afterInstruction(hook, pc); \
+    if (state.interrupts) pc = this->servicePending(pc); \
+    if (cycles <= 0) goto done; \
+    DISPATCH(); \
+  } while (0)
+
+#define BRANCH_IF(Condition) \
+  if (Condition) pc = static_cast<uint16_t>(pc + op->operand); \
+  NEXT()
+
+    this->updateTag();
+    this->flags.load(state.p);
+    if (state.interrupts) pc = this->servicePending(pc);
+    if (cycles <= 0) goto done;
+    DISPATCH();
+
+#ifndef THREADED_COMPUTED_GOTO
+dispatch:
+    switch (op->command) {
+#endif
+    HANDLER(ADC):
+      this->adc(this->read(*op));
+      NEXT();
+    HANDLER(AND):
+      state.a = this->setNz(state.a & this->read(*op));
+      NEXT();
+    HANDLER(ASL):
+      this->rmw(*op, [this](uint8_t v) {
+        this->flags.setCarry(v >= 0x80);
+        return this->setNz(v << 1);
+      });
+      NEXT();
+    HANDLER(BCC):
+      BRANCH_IF(!this->flags.carry());
+    HANDLER(BCS):
+      BRANCH_IF(this->flags.carry());
+    HANDLER(BEQ):
+      BRANCH_IF(this->flags.zero());
+    HANDLER(BIT): {
+      uint8_t value = this->read(*op);
+      this->flags.z = state.a & value;
+      this->flags.n = value;
+      this->flags.setOverflow((value & (1 << 6)) != 0);
+      NEXT();
+    }
+    HANDLER(BMI):
+      BRANCH_IF(this->flags.negative());
+    HANDLER(BNE):
+      BRANCH_IF(!this->flags.zero());
+    HANDLER(BPL):
+      BRANCH_IF(!this->flags.negative());
+    HANDLER(BRK):
+      state.pc = pc;
+      this->syncFlags();
+      this->core->interrupt(Cpu::Break, true);
+      pc = state.pc;
+      NEXT();
+    HANDLER(BVC):
+      BRANCH_IF(!this->flags.overflow());
+    HANDLER(BVS):
+      BRANCH_IF(this->flags.overflow());
+    HANDLER(CLC):
+      this->flags.setCarry(false);
+      NEXT();
+    HANDLER(CLD):
+      state.setFlag(Flag::Decimal, false);
+      NEXT();
+    HANDLER(CLI):
+      state.setFlag(Flag::Interrupt, false);
+      NEXT();
+    HANDLER(CLV):
+      this->flags.setOverflow(false);
+      NEXT();
+    HANDLER(CMP):
+      this->compare(state.a, this->read(*op));
+      NEXT();
+    HANDLER(CPX):
+      this->compare(state.x, this->read(*op));
+      NEXT();
+    HANDLER(CPY):
+      this->compare(state.y, this->read(*op));
+      NEXT();
+    HANDLER(DEC):
+    HANDLER(DEX):
+    HANDLER(DEY):
+      this->rmw(*op, [this](uint8_t v) { return this->setNz(v - 1); });
+      NEXT();
+    HANDLER(EOR):
+      state.a = this->setNz(state.a ^ this->read(*op));
+      NEXT();
+    HANDLER(INC):
+    HANDLER(INX):
+    HANDLER(INY):
+      this->rmw(*op, [this](uint8_t v) { return this->setNz(v + 1); });
+      NEXT();
+    HANDLER(JMP):
+      pc = this->resolve(*op);
+      NEXT();
+    HANDLER(JSR):
+      this->core->push(static_cast<uint16_t>(pc - 1));
+      pc = op->operand;
+      NEXT();
+    HANDLER(LDA):
+      state.a = this->setNz(this->read(*op));
+      NEXT();
+    HANDLER(LDX):
+      state.x = this->setNz(this->read(*op));
+      NEXT();
+    HANDLER(LDY):
+      state.y = this->setNz(this->read(*op));
+      NEXT();
+    HANDLER(LSR):
+      this->rmw(*op, [this](uint8_t v) {
+        this->flags.setCarry((v & 1) == 1);
+        return this->setNz(v >> 1);
+      });
+      NEXT();
+    HANDLER(NOP):
+      NEXT();
+    HANDLER(ORA):
+      state.a = this->setNz(state.a | this->read(*op));
+      NEXT();
+    HANDLER(PHA):
+      this->core->push(state.a);
+      NEXT();
+    HANDLER(PHP):
+      this->core->push(static_cast<uint8_t>(this->flags.apply(state.p) | static_cast<uint8_t>(Flag::Break) | static_cast<uint8_t>(Flag::AlwaysOne)));
+      NEXT();
+    HANDLER(PLA):
+      state.a = this->setNz(this->core->pull());
+      NEXT();
+    HANDLER(PLP):
+      state.p = this->core->pull();
+      this->flags.load(state.p);
+      NEXT();
+    HANDLER(ROL):
+      this->rmw(*op, [this](uint8_t v) {
+        uint8_t c = this->flags.c;
+        this->flags.setCarry(v >= 0x80);
+        return this->setNz((v << 1) | c);
+      });
+      NEXT();
+    HANDLER(ROR):
+      this->rmw(*op, [this](uint8_t v) {
+        uint8_t c = this->flags.c << 7;
+        this->flags.setCarry((v & 1) == 1);
+        return this->setNz((v >> 1) | c);
+      });
+      NEXT();
+    HANDLER(RTI):
+      state.p = this->core->pull();
+      this->flags.load(state.p);
+      pc = this->core->pull16();
+      NEXT();
+    HANDLER(RTS):
+      pc = static_cast<uint16_t>(this->core->pull16() + 1);
+      NEXT();
+    HANDLER(SBC):
+      // Invert using 1s complement, the Carry will then adjust.
+      this->adc(this->read(*op) ^ 0xFF);
+      NEXT();
+    HANDLER(SEC):
+      this->flags.setCarry(true);
+      NEXT();
+    HANDLER(SED):
+      state.setFlag(Flag::Decimal, true);
+      NEXT();
+    HANDLER(SEI):
+      state.setFlag(Flag::Interrupt, true);
+      NEXT();
+    HANDLER(STA):
+      this->write(*op, state.a);
+      NEXT();
+    HANDLER(STX):
+      this->write(*op, state.x);
+      NEXT();
+    HANDLER(STY):
+      this->write(*op, state.y);
+      NEXT();
+    HANDLER(TAX):
+      state.x = this->setNz(state.a);
+      NEXT();
+    HANDLER(TAY):
+      state.y = this->setNz(state.a);
+      NEXT();
+    HANDLER(TSX):
+      state.x = this->setNz(state.s);
+      NEXT();
+    HANDLER(TXA):
+      state.a = this->setNz(state.x);
+      NEXT();
+    HANDLER(TXS):
+      state.s = state.x;
+      NEXT();
+    HANDLER(TYA):
+      state.a = this->setNz(state.y);
+      NEXT();
+    HANDLER(Unknown):
+#ifndef THREADED_COMPUTED_GOTO
+    default:
+#endif
+      state.pc = pc;
+      throw std::runtime_error("Unknown instruction encountered");
+#ifndef THREADED_COMPUTED_GOTO
+    }
+#endif
+
+#undef BRANCH_IF
+#undef NEXT
+#undef DISPATCH
+#undef GOTO_HANDLER
+#undef HANDLER
+#undef THREADED_ADDRESS
+#undef THREADED_COMMANDS
+
+done:
+    state.pc = pc;
+    this->syncFlags();
+    return cycles;
+  }
+
+  /** Takes a pending interrupt, if any.  Returns the address to resume at. */
+  uint16_t servicePending(uint16_t pc) {
+    this->state.pc = pc;
+    this->syncFlags(); // The interrupt pushes the PSW.
+    this->core->servicePending(); // Calls jump() if it took one.
+    return this->state.pc;
+  }
+
+  template<typename Hook>
+  void beforeInstruction(Hook &hook, uint16_t pc, int length) {
+    this->hooked = fetchInstruction(this->mem.get(), pc);
+    this->state.pc = pc;
+    this->syncFlags();
+    hook.beforeInstruction(this->hooked, this->state);
+    this->flags.load(this->state.p);
+    this->state.pc = static_cast<uint16_t>(pc + length);
+  }
+
+  template<typename Hook>
+  void afterInstruction(Hook &hook, uint16_t pc) {
+    this->state.pc = pc;
+    this->syncFlags();
+    hook.afterInstruction(this->hooked, this->state);
+    this->flags.load(this->state.p);
+  }
+
+  /** Returns the predecoded instruction at \a pc, decoding it if required. */
+  const Op *fetch(uint16_t pc) {
+    Op *page = this->pages[pc / PAGE_SIZE];
+
+    if (!page) {
+      page = this->mapPage(pc / PAGE_SIZE);
+      if (!page) return this->decode(pc, &this->scratch);
+    }
+
+    Op *op = page + (pc % PAGE_SIZE);
+    if (!op->length) {
+      if (pc >= ROM_BEGIN) op = this->ownRomPage(pc / PAGE_SIZE) + (pc % PAGE_SIZE);
+      return this->decode(pc, op);
+    }
+
+    return op;
+  }
+
+  /**
+   * Maps the instruction cache of \a page.  Returns \c nullptr if the code in
+   * there is not cacheable.
+   */
+  Op *mapPage(int page) {
+    int address = page * PAGE_SIZE;
+
+    if (address >= ROM_BEGIN) {
+      // A bank taken over from another core may have it mapped already.
+      std::shared_ptr<RomPage> &rom = this->bank->pages[page - ROM_BEGIN / PAGE_SIZE];
+      if (!rom) rom = std::make_shared<RomPage>();
+      return this->pages[page] = rom->ops;
+    } else if (address >= WRAM_BEGIN) {
+      this->wramOps.reset(new Op[WRAM_PAGES * PAGE_SIZE]);
+      for (int i = 0; i < WRAM_PAGES; i++) {
+        this->pages[WRAM_BEGIN / PAGE_SIZE + i] = this->wramOps.get() + i * PAGE_SIZE;
+      }
+
+      return this->pages[page];
+    }
+
+    // Code in the I/O registers or on the stack.
+    return nullptr;
+  }
+
+  /**
+   * Returns the instruction cache of the mapped ROM \a page for writing.  A
+   * shared page is copied first, so other cores never see it change.
+   */
+  Op *ownRomPage(int page) {
+    std::shared_ptr<RomPage> &rom = this->bank->pages[page - ROM_BEGIN / PAGE_SIZE];
+
+    if (rom->shared) {
+      std::shared_ptr<RomPage> copy = std::make_shared<RomPage>();
+      std::copy(rom->ops, rom->ops + PAGE_SIZE, copy->ops);
+      rom = std::move(copy);
+      this->pages[page] = rom->ops;
+    }
+
+    return rom->ops;
+  }
+
+  /** Decodes the instruction at \a pc into \a op.  Returns the instruction. */
+  const Op *decode(uint16_t pc, Op *op) {
+    Instruction instr = fetchInstruction(this->mem.get(), pc);
+    int length = 1 + instr.operandSize();
+
+    if (op != &this->scratch && pc < ROM_BEGIN) {
+      // Instructions reaching into the next page could be overwritten without
+      // us noticing, so don't cache these.
+      if ((pc % PAGE_SIZE) + length > PAGE_SIZE) {
+        op = &this->scratch;
+      } else if (pc < Cpu::Memory::RAM_BARRIER) {
+        this->ramCode |= 1 << ((pc / PAGE_SIZE) % RAM_PAGES);
+      } else {
+        this->wramCode |= 1u << ((pc - WRAM_BEGIN) / PAGE_SIZE);
+      }
+    }
+
+    op->command = instr.command;
+    op->mode = instr.addressing;
+    op->cycles = static_cast<uint8_t>(instr.cycles);
+    op->length = static_cast<uint8_t>(length);
+    op->handler = this->handlers ? this->handlers[instr.command] : nullptr;
+
+    switch (instr.addressing) {
+    default:
+      op->operand = instr.op16;
+      break;
+    case Instruction::Imm:
+    case Instruction::Imp:
+      op->operand = instr.op8;
+      break;
+    case Instruction::Rel: // Keep the sign, as RAM code is mirrored.
+      op->operand = static_cast<uint16_t>(static_cast<int16_t>(instr.ops8));
+      break;
+    case Instruction::Zp:
+      op->mode = Ram;
+      op->operand = instr.op8;
+      break;
+    case Instruction::Abs:
+      if (instr.op16 < Cpu::Memory::RAM_BARRIER && !instr.isBranching()) {
+        op->mode = Ram;
+        op->operand = instr.op16 % Cpu::Memory::RAM_SIZE;
+      } else {
+        op->operand = instr.op16;
+      }
+      break;
+    }
+
+    return op;
+  }
+
+  /** Drops all cached instructions. */
+  void invalidate() {
+    this->banks.clear();
+    this->bank = nullptr;
+    this->wramOps.reset();
+    this->wramCode = 0;
+    std::fill(this->ramOps, this->ramOps + Cpu::Memory::RAM_SIZE, Op());
+    this->ramCode = 0;
+
+    std::fill(this->pages + WRAM_BEGIN / PAGE_SIZE, this->pages + PAGE_COUNT, nullptr);
+    this->updateTag();
+  }
+
+  /** Drops all instructions cached from the RAM and the cartridge RAM. */
+  void invalidateRamCode() {
+    for (int page = 0; page < RAM_PAGES; page++) {
+      if (this->ramCode & (1 << page)) this->invalidateRam(page);
+    }
+
+    for (int page = 0; page < WRAM_PAGES; page++) {
+      if (this->wramCode & (1u << page)) this->invalidateWram(page);
+    }
+  }
+
+  /**
+   * Starts out with the cartridge ROM cache of \a other.  Each page is shared
+   * until either core decodes more instructions into it.
+   */
+  void shareCode(const ThreadedCoreImpl *other) {
+    // Instructions are only cached for the handlers they were decoded with.
+    if (!other->handlers || (this->handlers && this->handlers != other->handlers)) return;
+
+    for (const auto &it : other->banks) {
+      for (const std::shared_ptr<RomPage> &rom : it.second.pages) {
+        if (rom) rom->shared = true;
+      }
+    }
+
+    this->handlers = other->handlers;
+    this->banks = other->banks;
+    this->bank = nullptr;
+    std::fill(this->pages + ROM_BEGIN / PAGE_SIZE, this->pages + PAGE_COUNT, nullptr);
+  }
+
+  /** Switches the cartridge ROM cache over to the current tag. */
+  void updateTag() {
+    uint64_t tag = this->mem->tag();
+    if (this->bank && tag == this->tag) return;
+
+    Bank &bank = this->banks[tag];
+    this->tag = tag;
+    this->bank = &bank;
+
+    for (int i = 0; i < ROM_PAGES; i++) {
+      RomPage *rom = bank.pages[i].get();
+      this->pages[ROM_BEGIN / PAGE_SIZE + i] = rom ? rom->ops : nullptr;
+    }
+  }
+
+  /** Drops all cached instructions in the RAM \a page. */
+  void invalidateRam(int page) {
+    std::fill(this->ramOps + page * PAGE_SIZE, this->ramOps + (page + 1) * PAGE_SIZE, Op());
+    this->ramCode &= ~(1 << page);
+  }
+
+  /** Drops all cached instructions in the cartridge RAM \a page. */
+  void invalidateWram(int page) {
+    Op *ops = this->wramOps.get() + page * PAGE_SIZE;
+    std::fill(ops, ops + PAGE_SIZE, Op());
+    this->wramCode &= ~(1u << page);
+  }
+
+  /** Writes \a value into the RAM at \a offset. */
+  void storeRam(uint16_t offset, uint8_t value) {
+    int page = offset / PAGE_SIZE;
+    this->ram[offset] = value;
+    if (this->ramCode & (1 << page)) this->invalidateRam(page);
+  }
+
+  /** Writes \a value to the \a address. */
+  void store(uint16_t address, uint8_t value) {
+    if (address < Cpu::Memory::RAM_BARRIER) {
+      return this->storeRam(address % Cpu::Memory::RAM_SIZE, value);
+    }
+
+    this->mem->write(address, value);
+
+    if (address >= WRAM_BEGIN && address < ROM_BEGIN) {
+      int page = (address - WRAM_BEGIN) / PAGE_SIZE;
+      if (this->wramCode & (1u << page)) this->invalidateWram(page);
+    } else if (address >= ROM_BEGIN) {
+      // Writes to the mapper may switch banks.
+      this->updateTag();
+    }
+  }
+
+  /** Reads the byte at \a address. */
+  uint8_t load(uint16_t address) {
+    if (address < Cpu::Memory::RAM_BARRIER) return this->ram[address % Cpu::Memory::RAM_SIZE];
+    return this->mem->read(address);
+  }
+
+  /** Evaluates the lazy flags into the PSW, so it can be observed. */
+  void syncFlags() {
+    this->state.p = this->flags.apply(this->state.p);
+  }
+
+  /** Updates the Negative and Zero flags, and returns \a value. */
+  uint8_t setNz(uint8_t value) {
+    return this->flags.setNz(value);
+  }
+
+  /** Compares the value of \a to \a op. */
+  void compare(uint8_t reg, uint8_t op) {
+    this->flags.setCarry(reg >= op);
+    this->setNz(reg - op);
+  }
+
+  /** Shared implementation for ADC and SBC instructions. */
+  void adc(uint8_t right8) {
+    uint16_t left = static_cast<uint16_t>(this->state.a);
+    uint16_t right = static_cast<uint16_t>(right8);
+
+    uint16_t c = this->flags.c;
+    this->state.a = this->flags.setNvzc(left, right, left + right + c);
+  }
+
+  /** Resolves the memory operand of \a op to an absolute address. */
+  uint16_t resolve(const Op &op) {
+    uint8_t addr8 = static_cast<uint8_t>(op.operand);
+
+    switch (op.mode) {
+    default: // Ram and Abs
+      return op.operand;
+    case Instruction::ZpX:
+      return (addr8 + this->state.x) & 0x00FF;
+    case Instruction::ZpY:
+      return (addr8 + this->state.y) & 0x00FF;
+    case Instruction::AbsX:
+      return op.operand + this->state.x;
+    case Instruction::AbsY:
+      return op.operand + this->state.y;
+    case Instruction::Ind:
+      return this->mem->read16(op.operand);
+    case Instruction::IndX:
+      return this->mem->read16((addr8 + this->state.x) & 0x00FF);
+    case Instruction::IndY:
+      return this->mem->read16(addr8) + this->state.y;
+    }
+  }
+
+  /** Reads the byte \a op is pointing at, be it a memory address or a register. */
+  uint8_t read(const Op &op) {
+    switch (op.mode) {
+    case Ram: return this->ram[op.operand];
+    case Instruction::Acc: return this->state.a;
+    case Instruction::X: return this->state.x;
+    case Instruction::Y: return this->state.y;
+    case Instruction::S: return this->state.s;
+    case Instruction::P: return this->flags.apply(this->state.p);
+    case Instruction::Imm:
+    case Instruction::Imp:
+    case Instruction::Rel:
+      return static_cast<uint8_t>(op.operand);
+    default:
+      return this->load(this->resolve(op));
+    }
+  }
+
+  /** Writes the \a value into what \a op is pointing at. */
+  void write(const Op &op, uint8_t value) {
+    switch (op.mode) {
+    case Ram:
+      this->storeRam(op.operand, value);
+      break;
+    case Instruction::Acc:
+      this->state.a = value;
+      break;
+    case Instruction::X:
+      this->state.x = value;
+      break;
+    case Instruction::Y:
+      this->state.y = value;
+      break;
+    case Instruction::S:
+      this->state.s = value;
+      break;
+    case Instruction::P:
+      this->state.p = value;
+      this->flags.load(value);
+      break;
+    case Instruction::Imm:
+    case Instruction::Imp:
+    case Instruction::Rel:
+      throw std::runtime_error("Can't write to Imm/Imp/Rel addressing instruction");
+    default:
+      this->store(this->resolve(op), value);
+      break;
+    }
+  }
+
+  /**
+   * Reads the byte \a op is pointing at.  This byte is then passed to \a proc.
+   * The result of \a proc is then written back into the same place.
+   */
+  template<typename Proc>
+  void rmw(const Op &op, Proc proc) {
+    switch (op.mode) {
+    case Ram:
+      this->storeRam(op.operand, proc(this->ram[op.operand]));
+      break;
+    case Instruction::Acc:
+      this->state.a = proc(this->state.a);
+      break;
+    case Instruction::X:
+      this->state.x = proc(this->state.x);
+      break;
+    case Instruction::Y:
+      this->state.y = proc(this->state.y);
+      break;
+    case Instruction::S:
+      this->state.s = proc(this->state.s);
+      break;
+    case Instruction::P:
+      this->state.p = proc(this->flags.apply(this->state.p));
+      this->flags.load(this->state.p);
+      break;
+    case Instruction::Imm:
+      this->state.a = proc(static_cast<uint8_t>(op.operand));
+      break;
+    case Instruction::Rel:
+    case Instruction::Imp:
+      throw std::runtime_error("Can't RMW on a Rel/Imp adressing instruction");
+    default: {
+      uint16_t resolved = this->resolve(op);
+      this->store(resolved, proc(this->load(resolved)));
+      break;
+    }
+    }
+  }
+};
+
+namespace Interpret {
+ThreadedCore::ThreadedCore(const Cpu::Memory::Ptr &mem, Cpu::State state, QObject *parent)
+  : Base(mem, state, parent)
+{
+  this->impl = new ThreadedCoreImpl(this, this->m_state, mem);
+}
+
+ThreadedCore::~ThreadedCore() {
+  delete this->impl;
+}
+
+int ThreadedCore::run(int cycles) {
+  return this->impl->run(cycles);
+}
+
+void ThreadedCore::jump(uint16_t address) {
+  this->m_state.pc = address;
+}
+
+void ThreadedCore::invalidateRamCode() {
+  this->impl->invalidateRamCode();
+}
+
+void ThreadedCore::shareCode(const Cpu::Base *from) {
+  const ThreadedCore *other = qobject_cast<const ThreadedCore *>(from);
+  if (!other) return;
+
+  this->impl->shareCode(other->impl);
+}
+
+}
@@ -2,14 +2,12 @@
 
 #include <core/instruction.hpp>
 
-#include <analysis/branch.hpp>
 #include <analysis/function.hpp>
 
 #include <cpu/state.hpp>
 
 #include <sstream>
 #include <functional>
-#include <variant>
 #include <set>
 /************************* DEBUG FUNCTIONALITY FLAGS **************************/
 
@@ -195,10 +193,10 @@ struct Line {
 
 struct Translator {
   Context &ctx;
-  Analysis::Function &func;
+  const Analysis::Function &func;
   std::set<uint16_t> seen;
 
-  Translator(Context &c, Analysis::Function &f) : ctx(c), func(f) { }
+  Translator(Context &c, const Analysis::Function &f) : ctx(c), func(f) { }
 
   void unpackPsw() {
     this->ctx.stream << "C = " << this->ctx.machine.bitTest(Ref::p, (int)Cpu::Flag::Carry).name << "\n"
@@ -230,10 +228,10 @@ struct Translator {
     this->unpackPsw();
 
     // Make sure the root branch comes first:
-    this->branch(this->func.root());
+    this->branch(*this->func.root());
 
     // Then compile all other branches.
-    for(Analysis::Branch *br : this->func.branches()) this->branch(br);
+    for(const Analysis::Function::Branch &br : this->func.branches()) this->branch(br);
 
     // Epilogue: Return new state to the host and close the function.
     this->ctx.stream << "::eof::\n";
@@ -242,31 +240,30 @@ struct Translator {
                      << "end\n";
   }
 
-  void branch(Analysis::Branch *br) {
-    for(const Analysis::Branch::Element &el : br->elements()) {
-      uint16_t addr = el.first;
+  void branch(const Analysis::Function::Branch &br) {
+    for(size_t i = br.begin; i < br.end; i++) {
+      uint16_t addr = this->func.address(i);
 
       if (!handleInstruction(addr)) continue;
 
       // Give each instruction a jump label
       Line(this) << "\n::instr_" << addr << "::"; // `::instr_ADDR::`
 
-      Analysis::Branch::Instruction instr = el.second;
-      if (auto normal = std::get_if<Core::Instruction>(&instr)) {
-        this->putInstructionTrace(addr, *normal);
-        this->instruction(addr, *normal);
+      Core::Instruction instr = this->func.instruction(i);
+      if (!instr.isConditionalBranching()) {
+        this->putInstructionTrace(addr, instr);
+        this->instruction(addr, instr);
 
         // Force sequential execution.  If multiple branches are interspersed,
         // it can happen that the sequential flow in the Lua function doesn't
         // reflect the wanted execution flow.
-        if (!normal->isBranching()) {
-          uint16_t nextAddr = addr + static_cast<uint16_t>(normal->operandSize()) + 1;
+        if (!instr.isBranching()) {
+          uint16_t nextAddr = addr + static_cast<uint16_t>(instr.operandSize()) + 1;
           Line(this) << "goto instr_" << nextAddr;
         }
       } else {
-        Analysis::ConditionalInstruction cond = std::get<Analysis::ConditionalInstruction>(instr);
-        this->putInstructionTrace(addr, cond);
-        this->instruction(cond);
+        this->putInstructionTrace(addr, instr);
+        this->conditionalInstruction(addr, instr);
       }
     }
   }
@@ -584,7 +581,7 @@ struct Translator {
     }
   }
 
-  const Ref &conditionTest(Analysis::ConditionalInstruction instr) {
+  const Ref &conditionTest(const Core::Instruction &instr) {
     using Core::Instruction;
 
     static const Ref bcc{ "(C == false)" };
@@ -611,11 +608,11 @@ struct Translator {
     }
   }
 
-  void instruction(Analysis::ConditionalInstruction instr) {
+  void conditionalInstruction(uint16_t address, const Core::Instruction &instr) {
     this->reduceCycleCount(instr.cycles);
 
-    uint16_t truthy = instr.trueBranch()->start();
-    uint16_t falsy = instr.falseBranch()->start();
+    uint16_t falsy = static_cast<uint16_t>(address + instr.operandSize() + 1);
+    uint16_t truthy = instr.destinationAddress(falsy);
     Ref condition = this->conditionTest(instr);
 
     // First check for cycle exhaustion.  If no cycles are left compute the
@@ -813,7 +810,7 @@ CodeGenerator::~CodeGenerator() {
   delete this->m_machine;
 }
 
-std::string CodeGenerator::translate(Analysis::Function &func) {
+std::string CodeGenerator::translate(const Analysis::Function &func) {
   Stream b;
   Context ctx(b, *this->m_machine);
   Translator translator(ctx, func);
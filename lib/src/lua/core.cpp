@@ -130,7 +130,7 @@ struct CorePrivate {
     // Clear Lua's stack:
     lua_pop(this->lua, 8);
 
-    if (!func->analyzed().cacheable()) delete func;
+    if (!func->info().cacheable) delete func;
   }
 
   void run(Cpu::State &state) {
@@ -138,6 +138,10 @@ struct CorePrivate {
 
     bool running = true;
     while (running && state.cycles > 0) {
+      // The generated code doesn't check for interrupts, but returns to us
+      // often enough to take them here.
+      if (state.interrupts) this->core->servicePending();
+
       this->callOnce(state);
 
       switch (state.reason) {
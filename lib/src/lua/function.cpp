@@ -4,7 +4,7 @@
 
 namespace Lua {
 Function::Function(const Analysis::Function &analyzed, lua_State *lua, int ref)
-  : m_analyzed(analyzed), m_lua(lua), m_ref(ref)
+  : m_info(analyzed.info()), m_lua(lua), m_ref(ref)
 {
 }
 
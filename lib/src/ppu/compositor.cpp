@@ -0,0 +1,179 @@
+#include <ppu/compositor.hpp>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#  define COMPOSITOR_X86
+#  include <immintrin.h>
+#endif
+
+namespace Ppu {
+namespace Compositor {
+/** ARGB colors of all possible color indices. */
+struct ArgbTable {
+  uint32_t colors[256];
+
+  ArgbTable() {
+    for (int i = 0; i < 256; i++) {
+      this->colors[i] = (i < COLOR_COUNT) ? COLORS[i] : 0xFFFF0000; // Red on OOB.
+    }
+  }
+};
+
+static const ArgbTable argbTable;
+
+void drawTilesScalar(const TileSlice *slices, const uint8_t *attributes,
+                     const Palette *palettes, int count,
+                     uint8_t *output, uint8_t *opaque) {
+  for (int tile = 0; tile < count; tile++, output += 8) {
+    const TileSlice &slice = slices[tile];
+    const Palette &palette = palettes[attributes[tile]];
+
+    uint8_t bits = 0;
+    for (int x = 0; x < 8; x++) {
+      bits |= (!!slice.row[x]) << x;
+      output[x] = palette.colors[slice.row[x]];
+    }
+
+    opaque[tile] = bits;
+  }
+}
+
+void indexedToArgbScalar(const uint8_t *input, uint32_t *output, int count) {
+  for (int i = 0; i < count; i++) {
+    output[i] = argbTable.colors[input[i]];
+  }
+}
+
+#ifdef COMPOSITOR_X86
+/**
+ * Returns the opacity bitmap of the 8 color indices in the lower half of
+ * \a indices: Compare each against zero, and gather the inverted results.
+ */
+static inline uint8_t opacity(__m128i indices) {
+  __m128i transparent = _mm_cmpeq_epi8(indices, _mm_setzero_si128());
+  return static_cast<uint8_t>(~_mm_movemask_epi8(transparent));
+}
+
+/**
+ * SSE2 lacks a byte shuffle, so the color indices are compared against each
+ * possible value, selecting the matching color by masking.
+ */
+static void drawTilesSse2(const TileSlice *slices, const uint8_t *attributes,
+                          const Palette *palettes, int count,
+                          uint8_t *output, uint8_t *opaque) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i two = _mm_set1_epi8(2);
+  const __m128i three = _mm_set1_epi8(3);
+
+  __m128i colors[4][4];
+  for (int p = 0; p < 4; p++) {
+    for (int i = 0; i < 4; i++) colors[p][i] = _mm_set1_epi8(static_cast<char>(palettes[p].colors[i]));
+  }
+
+  for (int tile = 0; tile < count; tile++, output += 8) {
+    const __m128i *c = colors[attributes[tile]];
+    __m128i indices = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&slices[tile]));
+
+    __m128i color = _mm_and_si128(_mm_cmpeq_epi8(indices, zero), c[0]);
+    color = _mm_or_si128(color, _mm_and_si128(_mm_cmpeq_epi8(indices, one), c[1]));
+    color = _mm_or_si128(color, _mm_and_si128(_mm_cmpeq_epi8(indices, two), c[2]));
+    color = _mm_or_si128(color, _mm_and_si128(_mm_cmpeq_epi8(indices, three), c[3]));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output), color);
+
+    opaque[tile] = opacity(indices);
+  }
+}
+
+/**
+ * A palette fits into the lowest 4 Bytes of a register, so a single \c pshufb
+ * looks up all 8 pixels of a tile at once.
+ */
+__attribute__((target("ssse3")))
+static void drawTilesSsse3(const TileSlice *slices, const uint8_t *attributes,
+                           const Palette *palettes, int count,
+                           uint8_t *output, uint8_t *opaque) {
+  for (int tile = 0; tile < count; tile++, output += 8) {
+    int32_t palette;
+    ::memcpy(&palette, &palettes[attributes[tile]], sizeof(palette));
+
+    __m128i lut = _mm_cvtsi32_si128(palette);
+    __m128i indices = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&slices[tile]));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output), _mm_shuffle_epi8(lut, indices));
+
+    opaque[tile] = opacity(indices);
+  }
+}
+
+/** Widens 8 color indices at a time, and gathers their colors from the table. */
+__attribute__((target("avx2")))
+static void indexedToArgbAvx2(const uint8_t *input, uint32_t *output, int count) {
+  const int *table = reinterpret_cast<const int *>(argbTable.colors);
+  int i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(input + i));
+    __m256i indices = _mm256_cvtepu8_epi32(bytes);
+    __m256i colors = _mm256_i32gather_epi32(table, indices, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), colors);
+  }
+
+  indexedToArgbScalar(input + i, output + i, count - i);
+}
+#endif
+
+void SpriteLine::composite(uint8_t *output, const uint8_t *dots,
+                           const Palette *palettes, int minPos) const {
+  // Works on groups of 8 pixels, which line up with the Bytes in the bitmap.
+  for (int group = minPos / 8; group < 256 / 8; group++) {
+    uint64_t pixels;
+    ::memcpy(&pixels, this->m_pixels + group * 8, sizeof(pixels));
+    if (!pixels) continue;
+
+    uint8_t opaque = opaqueBits(pixels & 0x0303030303030303ULL);
+    uint8_t behind = opaqueBits((pixels >> 4) & 0x0101010101010101ULL);
+    unsigned int visible = opaque & ~(behind & dots[group]);
+
+    for (; visible; visible &= visible - 1) {
+      int x = group * 8 + __builtin_ctz(visible);
+      uint8_t pixel = this->m_pixels[x];
+      output[x] = palettes[(pixel >> PALETTE_SHIFT) & 3].colors[pixel & COLOR_MASK];
+    }
+  }
+}
+
+using DrawTilesFunc = void(*)(const TileSlice *, const uint8_t *, const Palette *,
+                              int, uint8_t *, uint8_t *);
+using IndexedToArgbFunc = void(*)(const uint8_t *, uint32_t *, int);
+
+static DrawTilesFunc selectDrawTiles() {
+#ifdef COMPOSITOR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) return &drawTilesSsse3;
+  return &drawTilesSse2;
+#else
+  return &drawTilesScalar;
+#endif
+}
+
+static IndexedToArgbFunc selectIndexedToArgb() {
+#ifdef COMPOSITOR_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return &indexedToArgbAvx2;
+#endif
+  return &indexedToArgbScalar;
+}
+
+static const DrawTilesFunc drawTilesImpl = selectDrawTiles();
+static const IndexedToArgbFunc indexedToArgbImpl = selectIndexedToArgb();
+
+void drawTiles(const TileSlice *slices, const uint8_t *attributes,
+               const Palette *palettes, int count,
+               uint8_t *output, uint8_t *opaque) {
+  drawTilesImpl(slices, attributes, palettes, count, output, opaque);
+}
+
+void indexedToArgb(const uint8_t *input, uint32_t *output, int count) {
+  indexedToArgbImpl(input, output, count);
+}
+}
+}
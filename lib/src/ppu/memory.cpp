@@ -2,9 +2,12 @@
 
 namespace Ppu {
 Memory::Memory(const Cartridge::Base::Ptr &cartridge)
-  : m_cartridge(cartridge)
+  : tiles(cartridge.get()), m_cartridge(cartridge)
 {
   this->m_cartridgePtr = this->m_cartridge.get();
+  this->m_cartridgePtr->setNameTableMemory(this->ram);
+  this->m_pages = this->m_cartridgePtr->ppuPages();
+  this->m_writePages = this->m_cartridgePtr->ppuWritePages();
   this->reset();
 }
 
@@ -28,10 +31,53 @@ void Memory::reset() {
   this->ppuAddr = 0;
 
   ::memset(this->ram, 0x0, sizeof(this->ram));
+  this->nameTableGeneration++;
   ::memset(this->oam, 0xFF, sizeof(this->oam));
+  this->oamGeneration++;
   ::memset(this->palettes, 0x0, sizeof(this->palettes));
 }
 
+void Memory::saveState(Core::StateWriter &out) const {
+  out.write(this->control);
+  out.write(this->mask);
+  out.write(this->status);
+  out.write(this->scrollX);
+  out.write(this->nextScrollX);
+  out.write(this->scrollY);
+  out.write(this->nextScrollY);
+  out.write(this->oamAddr);
+  out.write(this->ppuAddr);
+  out.write(this->oam);
+  out.write(this->palettes);
+  out.write(this->ram);
+  out.write(this->m_latch);
+  out.write(this->m_buffer);
+}
+
+void Memory::loadState(Core::StateReader &in) {
+  in.read(this->control);
+  in.read(this->mask);
+  in.read(this->status);
+  in.read(this->scrollX);
+  in.read(this->nextScrollX);
+  in.read(this->scrollY);
+  in.read(this->nextScrollY);
+  in.read(this->oamAddr);
+  in.read(this->ppuAddr);
+  in.read(this->oam);
+  this->oamGeneration++;
+  in.read(this->palettes);
+  in.read(this->ram);
+  this->nameTableGeneration++;
+  in.read(this->m_latch);
+  in.read(this->m_buffer);
+
+  // The CHR mapping and CHR RAM may have changed with the cartridge.  Tiles
+  // decoded from CHR ROM stay valid.
+  this->tiles.update();
+  this->tiles.clear();
+}
+
 static constexpr int ppuAddressIncrement(Controls control) {
   return control.testFlag(Ppu::BigIncrement) ? 32 : 1;
 }
@@ -85,8 +131,10 @@ void Memory::cpuWrite(int address, uint8_t value) {
     this->oamAddr = value;
     break;
   case 4: // OAMDATA
+    if (this->m_log) this->m_log->append(WriteLog::Entry(WriteLog::OamWrite, this->oamAddr, value));
     this->oam[this->oamAddr] = value;
     this->oamAddr++;
+    this->oamGeneration++;
     break;
   case 5: // PPUSCROLL
     if (!this->m_latch) {
@@ -121,39 +169,35 @@ void Memory::cpuWrite(int address, uint8_t value) {
   }
 }
 
-static int nameTableAddress(int offset, Mirroring mode) {
-  switch (mode) {
-  case Single:
-    return offset % NAME_TABLE_SIZE;
-  case Horizontal:
-    return ((offset / 2) & NAME_TABLE_SIZE) | (offset % NAME_TABLE_SIZE);
-  case Vertical:
-    return offset % (2 * NAME_TABLE_SIZE);
-  case Four:
-    return offset - NAME_TABLE_BASE;
-  default:
-    throw std::runtime_error("Unreachable");
-  }
-}
-
 uint8_t Memory::read(int address) {
   address &= (TOTAL_SIZE - 1); // Ignore higher address bits completely.
-  if (address < 0x2000) return this->m_cartridgePtr->readChr(address);
-  if (address < 0x3F00) return this->ram[nameTableAddress(address, this->m_cartridgePtr->nameTableMirroring())];
-  if (address < 0x4000) return this->palettes[paletteOffset(address)];
+  if (address >= PALETTES_BASE) return this->palettes[paletteOffset(address)];
 
-  return 0; // Ignore otherwise.
+  return this->m_pages[address / PAGE_SIZE][address % PAGE_SIZE];
 }
 
 void Memory::write(int address, uint8_t value) {
   address &= (TOTAL_SIZE - 1);
 
-  if (address < 0x2000) {
-    this->m_cartridgePtr->writeChr(address, value);
-  } else if (address < 0x3F00) {
-    this->ram[nameTableAddress(address, this->m_cartridgePtr->nameTableMirroring())] = value;
-  } else if (address < 0x4000) {
+  if (this->m_log) {
+    this->logMapping();
+    this->m_log->append(WriteLog::Entry(WriteLog::MemoryWrite, address, value));
+  }
+
+  if (address >= PALETTES_BASE) {
     this->palettes[paletteOffset(address)] = value;
+    return;
+  }
+
+  uint8_t *page = this->m_writePages[address / PAGE_SIZE];
+  if (!page) return; // Read-only CHR memory
+
+  page[address % PAGE_SIZE] = value;
+
+  if (address < NAME_TABLE_BASE) {
+    this->tiles.invalidate(address);
+  } else {
+    this->nameTableGeneration++;
   }
 }
 
@@ -176,4 +220,40 @@ OamSprite Memory::sprite(int index) {
 const OamSprite *Memory::sprites() const {
   return reinterpret_cast<const OamSprite *>(this->oam);
 }
+
+void Memory::setWriteLog(WriteLog *log) {
+  this->m_log = log;
+
+  // Log the whole mapping with the next entry.
+  for (const uint8_t *&page : this->m_loggedPages) page = nullptr;
+  this->m_loggedMirroring = -1;
+}
+
+void Memory::logScanLine(int line) {
+  this->logMapping();
+
+  WriteLog::Entry entry(WriteLog::ScanLine, line);
+  entry.registers.control = static_cast<uint8_t>(this->control);
+  entry.registers.mask = static_cast<uint8_t>(this->mask);
+  entry.registers.scrollX = this->scrollX.value;
+  entry.registers.scrollY = this->scrollY.value;
+  this->m_log->append(entry);
+}
+
+void Memory::logMapping() {
+  for (int i = 0; i < NAME_TABLE_BASE / PAGE_SIZE; i++) {
+    if (this->m_loggedPages[i] == this->m_pages[i]) continue;
+
+    WriteLog::Entry entry(WriteLog::ChrPage, i);
+    entry.page = this->m_pages[i];
+    this->m_log->append(entry);
+    this->m_loggedPages[i] = this->m_pages[i];
+  }
+
+  int mirroring = this->nameTableMirroring();
+  if (this->m_loggedMirroring != mirroring) {
+    this->m_log->append(WriteLog::Entry(WriteLog::NameTableMirroring, 0, mirroring));
+    this->m_loggedMirroring = mirroring;
+  }
+}
 }
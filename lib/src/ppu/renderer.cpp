@@ -1,18 +1,22 @@
 #include <ppu/renderer.hpp>
 
+#include <ppu/compositor.hpp>
+#include <ppu/triplebuffer.hpp>
+#include <cartridge/shadow.hpp>
 #include <cpu/base.hpp>
 
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <utility>
+
 #if __has_cpp_attribute(fallthrough)
 #  define FALLTHROUGH [[fallthrough]]
 #else
 #  define FALLTHROUGH
 #endif
 
-//#define DEBUG_SPRITES 0xFFFF0000
-
-/** Returns the \a n'th bit of \a x, shifted into the lowest position. */
-inline constexpr int bit(int x, int n) { return (x >> n) & 1; }
-inline constexpr bool bitTest(uint8_t *bitmap, int n) { return (bitmap[n / 8] >> (n % 8)) & 1; }
+//#define DEBUG_SPRITES 0x16 // Red
 
 namespace Ppu {
 struct Sprite {
@@ -24,32 +28,60 @@ struct Sprite {
   uint8_t flags = 0; ///< Flags
 };
 
-struct ScanLineTiles {
-  int y; // Inner y offset in [0, 8)
-  int x; // Offset, for scrolling.  Most likely negative.
+/**
+ * Tiles and their palettes of a name table row.  A row is shared by the
+ * 8 scan lines going through it, so it's only fetched again when the scroll
+ * position, the mirroring, or the name table memory changed.
+ */
+struct TileRow {
+  uint32_t generation = 0; ///< Name table generation it was fetched in
+  int key = -1; ///< Scroll position and mirroring it was fetched for
 
   // For scrolling, prepare to store one tile more than a single name table has.
   uint8_t tiles[NAMETABLE_COLUMNS + 1];
   uint8_t palettes[NAMETABLE_COLUMNS + 4];
+};
 
-  bool enabled; ///< Background rendering enabled?
+struct ScanLineTiles {
+  int y; // Inner y offset in [0, 8)
+  int x; // Offset, for scrolling.  Most likely negative.
+
+  const uint8_t *tiles; ///< Tiles to draw, in the current \c TileRow
+  const uint8_t *palettes; ///< Palettes of the tiles, in the current \c TileRow
 };
 
 struct ScanLineSprites {
   int count = 0;
   Sprite sprites[SPRITES_PER_LINE];
   bool overflow = false;
-  bool enabled; ///< Sprite rendering enabled?
-  int height; ///< Sprite height, either 8 or 16 (in pixel).
 };
 
-/** Horizontal slice of a tile. */
-union TileSlice {
-  uint8_t row[8];
-  uint64_t value;
+/**
+ * Mode bits of a visible scan line.  Each combination has its own
+ * specialization of \c RendererPrivate::drawScanLine(), so the drawing code
+ * doesn't have to test for these at run-time.
+ */
+enum ScanLineMode {
+  ModeBackground = 1 << 0, ///< Background rendering enabled
+  ModeSprites = 1 << 1, ///< Sprite rendering enabled
+  ModeBigSprites = 1 << 2, ///< Sprites are 8x16 pixels
+  ModeClipBackground = 1 << 3, ///< No background in the leftmost 8 pixels
+  ModeClipSprites = 1 << 4, ///< No sprites in the leftmost 8 pixels
+  ModeFineX = 1 << 5, ///< Background is scrolled by a fine-x offset
+
+  MODE_COUNT = 1 << 6
+};
+
+/** Sprites on each visible scan line, in OAM order. */
+struct SpriteTable {
+  uint32_t generation = 0; ///< OAM generation this table was built from
+  int height = 0; ///< Sprite height this table was built for
+  uint8_t count[Renderer::HEIGHT]; ///< Count of sprites per scan line
+  bool overflow[Renderer::HEIGHT]; ///< More sprites than could be drawn?
+  uint8_t sprites[Renderer::HEIGHT][SPRITES_PER_LINE]; ///< OAM indices
 };
 
-static_assert(sizeof(TileSlice) == sizeof(uint64_t), "TileSlice should be 8 byte wide");
+struct RenderThread;
 
 struct RendererPrivate {
   Memory *vram;
@@ -65,8 +97,19 @@ struct RendererPrivate {
   static constexpr int ATTR_TABLE_SIZE = 64; // 64B
 
   // TODO: Don't hardcode to NTSC
-  uint32_t pixels[Renderer::WIDTH * Renderer::HEIGHT];
+  static constexpr int FRAME_SIZE = Renderer::WIDTH * Renderer::HEIGHT;
+  uint8_t frame[FRAME_SIZE]; ///< Indices into \c COLORS
+  uint8_t *pixels = frame; ///< Frame being drawn into
+  void *target = nullptr; ///< Buffer of the front-end for the next frame
+  uint32_t argb[FRAME_SIZE]; ///< Only for \c Argb32 output
+  static constexpr int POST_LINE = Renderer::HEIGHT;
+  static constexpr int NMI_LINE = POST_LINE + 1;
   int scanLine = 0;
+  int preRenderLine = 261; ///< Last scan line of a frame
+  bool skipRaster = false; ///< Don't draw the current frame?
+  RenderThread *thread = nullptr; ///< Draws the frames instead, if set
+  SpriteTable spriteTable;
+  TileRow tileRow;
 
   static constexpr int patternTableAddress(bool which) {
     return which ? PATTERN_TABLE1 : PATTERN_TABLE0;
@@ -141,32 +184,51 @@ struct RendererPrivate {
   }
 
   /**
-   * Figures out which tiles to draw in the current scan line.
+   * Fetches the tiles and attributes of the current name table row into
+   * \c tileRow, unless it already holds them.
    */
-  ScanLineTiles analyzeScanLineNameTable() {
-    ScanLineTiles data;
-    data.x = this->vram->scrollX.fine;
-    data.y = this->vram->scrollY.fine;
-    data.enabled = this->vram->mask.testFlag(EnableBackground);
+  void fetchTileRow(bool extraTile) {
+    int column = this->vram->scrollX.coarse;
+    int row = this->vram->scrollY.coarse;
+    int nameTable = this->vram->scrollY.nameTable;
 
-    if (data.enabled) {
-      // Fetch tile indices to render from the name table:
-      int column = this->vram->scrollX.coarse;
-      int row = this->vram->scrollY.coarse;
-      int count = NAMETABLE_COLUMNS - column;
+    int key = nameTable | (column << 2) | (row << 7) | (extraTile << 12)
+            | (this->vram->nameTableMirroring() << 13);
 
-      int nameTable = NAME_TABLE + this->vram->scrollY.nameTable * NAME_TABLE_SIZE;
-      int second = ((nameTable & ~0x1F) ^ NAME_TABLE_SIZE);
-      int secondCount = NAMETABLE_COLUMNS - count;
+    TileRow &tileRow = this->tileRow;
+    if (tileRow.key == key && tileRow.generation == this->vram->nameTableGeneration)
+      return;
 
-      if (data.x) secondCount++;
+    // Fetch tile indices to render from the name table:
+    int count = NAMETABLE_COLUMNS - column;
+    int first = NAME_TABLE + nameTable * NAME_TABLE_SIZE;
+    int second = ((first & ~0x1F) ^ NAME_TABLE_SIZE);
+    int secondCount = NAMETABLE_COLUMNS - count + extraTile;
 
-      this->fetchNameTableTiles(nameTable, row, column, count + secondCount, data.tiles);
+    this->fetchNameTableTiles(first, row, column, count + secondCount, tileRow.tiles);
 
-      // Fetch attributes of the tiles in this scan line:
-      this->fetchTileAttributes(nameTable, row, column, count, data.palettes);
-      this->fetchTileAttributes(second, row, 0, secondCount, data.palettes + count);
-    }
+    // Fetch attributes of the tiles in this row:
+    this->fetchTileAttributes(first, row, column, count, tileRow.palettes);
+    this->fetchTileAttributes(second, row, 0, secondCount, tileRow.palettes + count);
+
+    tileRow.key = key;
+    tileRow.generation = this->vram->nameTableGeneration;
+  }
+
+  /**
+   * Figures out which tiles to draw in the current scan line.
+   */
+  template<int Mode>
+  ScanLineTiles analyzeScanLineNameTable() {
+    constexpr bool fineX = Mode & ModeFineX;
+
+    ScanLineTiles data;
+    data.x = fineX ? this->vram->scrollX.fine : 0;
+    data.y = this->vram->scrollY.fine;
+
+    this->fetchTileRow(fineX);
+    data.tiles = this->tileRow.tiles;
+    data.palettes = this->tileRow.palettes;
 
     return data;
   }
@@ -183,100 +245,136 @@ struct RendererPrivate {
   }
 
   /**
-   * Figures out which sprites could be drawn on the current scan line.
+   * Sorts the sprites in the OAM into buckets of the scan lines they're on,
+   * in a single pass over the OAM.  Stores \a height as sprite height.
    */
-  ScanLineSprites analyzeScanLineSprites() {
+  void buildSpriteTable(int height) {
     const OamSprite *oam = this->vram->sprites();
-    ScanLineSprites sprites;
-
-    sprites.enabled = this->vram->mask.testFlag(EnableSprites);
-    sprites.height = this->vram->control.testFlag(BigSprites) ? 16 : 8;
+    SpriteTable &table = this->spriteTable;
 
-    if (sprites.enabled) {
-      uint8_t min = this->scanLine - (sprites.height - 1); // Min/Max Y coordinates
-      uint8_t max = this->scanLine;
+    ::memset(table.count, 0, sizeof(table.count));
+    ::memset(table.overflow, 0, sizeof(table.overflow));
 
-      // Find sprites hitting the current scan line
-      for (int i = 0; i < SPRITE_COUNT; i++) {
-        if (oam[i].y > max || oam[i].y < min)
-          continue; // Not in current scan line
-
-        if (sprites.count >= SPRITES_PER_LINE) {
-          sprites.overflow = true;
+    for (int i = 0; i < SPRITE_COUNT; i++) {
+      // The first height-1 scan lines have no sprites, as their range of
+      // possible sprite Y coordinates would wrap around.
+      int first = std::max<int>(oam[i].y, height - 1);
+      int last = std::min<int>(oam[i].y + height - 1, Renderer::HEIGHT - 1);
+
+      for (int line = first; line <= last; line++) {
+        if (table.count[line] >= SPRITES_PER_LINE) {
+          table.overflow[line] = true;
         } else {
-          sprites.sprites[sprites.count] = spriteFromOam(i, oam[i], max);
-          sprites.count++;
+          table.sprites[line][table.count[line]] = static_cast<uint8_t>(i);
+          table.count[line]++;
         }
       }
     }
 
+    table.generation = this->vram->oamGeneration;
+    table.height = height;
+  }
+
+  /**
+   * Returns the sprite table for sprites of \a height, rebuilding it if the
+   * OAM or the sprite height changed since.
+   */
+  const SpriteTable &updateSpriteTable(int height) {
+    const SpriteTable &table = this->spriteTable;
+
+    if (table.generation != this->vram->oamGeneration || table.height != height)
+      this->buildSpriteTable(height);
+
+    return table;
+  }
+
+  /**
+   * Figures out which sprites could be drawn on the current scan line.  The
+   * sprite table is only rebuilt if the OAM or the sprite \a height changed.
+   */
+  ScanLineSprites analyzeScanLineSprites(int height) {
+    const OamSprite *oam = this->vram->sprites();
+    const SpriteTable &table = this->updateSpriteTable(height);
+    ScanLineSprites sprites;
+
+    sprites.count = table.count[this->scanLine];
+    sprites.overflow = table.overflow[this->scanLine];
+
+    for (int i = 0; i < sprites.count; i++) {
+      int id = table.sprites[this->scanLine][i];
+      sprites.sprites[i] = spriteFromOam(id, oam[id], this->scanLine);
+    }
+
     return sprites;
   }
 
   /**
    * Gets the horizontal 8px-wide slice in the \a index'th tile in the pattern
-   * table at \a base.  The \a y'th row in the 8px-high tile is fetched.
-   *
-   * Pattern data supports 4 different colors per pixel.  This takes two bits to
-   * represent, stored in two distinct planes.  Each plane stores one bit
-   * of color information per pixel.  Each byte stores information of 8 pixels.
-   * Each plane needing 8x8 Bits, or 8 Byte, make the second plane offset by
-   * 8 Bytes from the beginning of the pattern data.
+   * table at \a base.  The \a y'th row in the 8px-high tile is fetched.  The
+   * tile is flipped vertically if \a flipV is \c true, and horizontally if
+   * \a flipH is \c true.
    *
-   * The first plane stores the low bit, the second the high bit.  The color
-   * is then looked up in the color palette chosen for this tile (the name table
-   * uses its attribute tables, and sprites points to it in their structure).
-   *
-   * The lowest bit (Bit 0) corresponds to the first pixel (Pixel 0) in each
-   * row.
+   * The slice comes out of the decoded tile cache.  The color is then looked
+   * up in the color palette chosen for this tile (the name table uses its
+   * attribute tables, and sprites points to it in their structure).
    */
-  TileSlice tileSlice(int base, int index, int y, bool flip = false) {
-    if (flip) y = 7 - y;
-    int address = base + index * 16 + y;
-    int lo = this->vram->read(address + 0);
-    int hi = this->vram->read(address + 8);
-
-    TileSlice slice;
-    for (int i = 0; i < 8; i++) slice.row[i] = bit(lo, 7 - i) | (bit(hi, 7 - i) << 1);
-    return slice;
+  TileSlice tileSlice(int base, int index, int y, bool flipV = false, bool flipH = false) {
+    if (flipV) y = 7 - y;
+    return this->vram->tiles.slice(base, index, y, flipH);
   }
 
   /**
    * Draws the background tiles from \a bg into the frame buffer.  Also updates
    * the \a dots bitmap, setting or clearing a bit at the same "x" depending on
    * if the pixel there was non-zero (= set), or zero (= unset).
+   *
+   * The tiles are composited into a line buffer first, which is then copied
+   * into the frame buffer shifted by the fine-x scroll.
    */
+  template<int Mode>
   void drawBackground(const ScanLineTiles &bg, uint8_t *dots) {
-    int patterns = this->backgroundPatternTable();
+    constexpr bool fineX = Mode & ModeFineX;
+    constexpr int columnCount = NAMETABLE_COLUMNS + fineX;
+    // If there's fine-x scrolling, draw an extra tile ^
 
-    uint32_t *output = this->pixels + this->scanLine * Renderer::WIDTH;
+    int patterns = this->backgroundPatternTable();
+    uint8_t *output = this->pixels + this->scanLine * Renderer::WIDTH;
     int startX = bg.x;
-    int pos = 0;
-    int columnCount = NAMETABLE_COLUMNS + !!bg.x;
-    // If there's fine-x scrolling, draw an extra tile ^
 
     Palette palettes[4] = {
       this->vram->palette(0), this->vram->palette(1), this->vram->palette(2), this->vram->palette(3)
     };
 
-    int minPos = this->vram->mask.testFlag(ShowBackgroundLeftmost) ? 0 : 8;
-
+    TileSlice slices[NAMETABLE_COLUMNS + 1];
     for (int column = 0; column < columnCount; column++) {
-      TileSlice slice = this->tileSlice(patterns, bg.tiles[column], bg.y);
-      Palette palette = palettes[bg.palettes[column]];
-
-      uint8_t bits = 0;
-      for (int x = startX; x < 8 && pos < Renderer::WIDTH; x++, pos++) {
-        if (pos >= minPos) {
-          bits |= (!!slice.row[x]) << x;
-          output[pos] = palette.argb(slice.row[x]);
-        } else { // Draw backdrop color otherwise
-          output[pos] = palette.argb(0);
-        }
-      }
+      slices[column] = this->tileSlice(patterns, bg.tiles[column], bg.y);
+    }
+
+    uint8_t line[(NAMETABLE_COLUMNS + 1) * 8];
+    Compositor::drawTiles(slices, bg.palettes, palettes, columnCount, line, dots);
+    ::memcpy(output, line + startX, Renderer::WIDTH * sizeof(*output));
+
+    // Draw backdrop color in the leftmost 8 pixels if requested.
+    if (Mode & ModeClipBackground) ::memset(output, palettes[0].colors[0], 8);
+
+    this->clipBackgroundDots<Mode>(dots, startX);
+  }
 
-      dots[column] = bits;
-      startX = 0;
+  /**
+   * Clears the bits in the \a dots bitmap of pixels which aren't visible on
+   * screen, due to the fine-x scroll \a startX or the left column clipping.
+   */
+  template<int Mode>
+  static void clipBackgroundDots(uint8_t *dots, int startX) {
+    // Pixels scrolled out of the screen are not opaque.
+    if (Mode & ModeFineX) {
+      dots[0] &= 0xFF << startX;
+      dots[NAMETABLE_COLUMNS] &= (1 << startX) - 1;
+    }
+
+    if (Mode & ModeClipBackground) {
+      dots[0] = 0;
+      dots[1] &= 0xFF << startX;
     }
   }
 
@@ -285,14 +383,16 @@ struct RendererPrivate {
    * an opaque pixel in the background.  If so, updates \c PPUSTATUS setting the
    * SpriteHit flag.
    */
-  void sprite0HitTest(int x, TileSlice slice, uint8_t *dots) {
-    if (slice.value == 0) return;
+  void sprite0HitTest(int x, TileSlice slice, const uint8_t *dots) {
+    int count = Renderer::WIDTH - 1 - x; // No hit in the right-most pixel
+    if (count <= 0 || slice.value == 0) return;
 
-    for (int i = 0; i < 8 && x < Renderer::WIDTH - 1; i++, x++) {
-      if (slice.row[i] && bitTest(dots, x)) {
-        this->vram->status.setFlag(SpriteHit, true);
-        break;
-      }
+    unsigned int sprite = Compositor::opaqueBits(slice.value);
+    unsigned int background = (dots[x / 8] | (dots[x / 8 + 1] << 8)) >> (x % 8);
+    if (count < 8) sprite &= (1u << count) - 1;
+
+    if (sprite & background) {
+      this->vram->status.setFlag(SpriteHit, true);
     }
   }
 
@@ -307,89 +407,174 @@ struct RendererPrivate {
     }
   }
 
+  /** Returns the slice of sprite \a s in the current scan line. */
+  template<int Height>
+  TileSlice spriteSlice(const Sprite &s) {
+    // If we're using double-height sprites, the lowest bit of the tile id
+    // determines the pattern table to use.
+    // For normal-height sprites, we use the selected sprite pattern table.
+    int patterns = (Height > 8) ? patternTableAddress(s.tileId & 1) : this->spritePatternTable();
+    int tileId = tileIndex(s.tileId, Height, s.y, s.flags & FlipVertical);
+    return this->tileSlice(patterns, tileId, s.y & 7, s.flags & FlipVertical,
+                           s.flags & FlipHorizontal);
+  }
+
   /**
    * Draws the sprites into the frame buffer as indicated by \a sprites.
    */
-  void drawSprites(const ScanLineSprites &sprites, uint8_t *dots, bool doHitTest) {
+  template<int Mode>
+  void drawSprites(const ScanLineSprites &sprites, const uint8_t *dots) {
+    constexpr int height = (Mode & ModeBigSprites) ? 16 : 8;
+    constexpr int minPos = (Mode & ModeClipSprites) ? 8 : 0;
+    constexpr bool doHitTest = Mode & ModeBackground;
+
     if (sprites.overflow) this->vram->status.setFlag(SpriteOverflow, true);
     if (sprites.count < 1) return;
 
-    int minPos = this->vram->mask.testFlag(ShowSpritesLeftmost) ? 0 : 8;
-    uint32_t *output = this->pixels + this->scanLine * Renderer::WIDTH;
+    uint8_t *output = this->pixels + this->scanLine * Renderer::WIDTH;
     Palette palettes[4] = {
       this->vram->palette(4), this->vram->palette(5), this->vram->palette(6), this->vram->palette(7)
     };
 
-    // Grab the tile slices of all possible sprites
-    TileSlice slices[8];
+    // Draw the sprites back to front into the line buffer
+    Compositor::SpriteLine line;
+    line.clear();
 
-    for (int i = 0; i < sprites.count; i++) {
-      // If we're using double-height sprites, the lowest bit of the tile id
-      // determines the pattern table to use.
-      // For normal-height sprites, we use the selected sprite pattern table.
+    for (int i = sprites.count - 1; i >= 0; i--) {
       Sprite s = sprites.sprites[i];
-      int patterns = (sprites.height > 8) ? patternTableAddress(s.tileId & 1) : this->spritePatternTable();
-      int tileId = tileIndex(s.tileId, sprites.height, s.y, s.flags & FlipVertical);
-      slices[i] = this->tileSlice(patterns, tileId, s.y & 7, s.flags & FlipVertical);
+      TileSlice slice = this->spriteSlice<height>(s);
+
+      line.draw(s.x, slice, s.palette, s.flags & NoPriority);
 
       // Do the Sprite0 hit test while we're here
-      if (doHitTest && s.id == 0) this->sprite0HitTest(s.x, slices[i], dots);
+      if (doHitTest && s.id == 0) this->sprite0HitTest(s.x, slice, dots);
     }
 
-    // Check for every single dot in the column
-    for (int x = minPos; x < Renderer::WIDTH; x++) {
-      int palette = 0;
-      int color = 0;
-      bool noPriority = false;
-
-      // Check each sprite if it should be drawn here
-      for (int i = 0; i < sprites.count; i++) {
-        Sprite s = sprites.sprites[i];
-        if (x < s.x || x > s.x + 7) continue; // Sprite in X-range?
-
-        int localX = x - s.x;
-        if (s.flags & FlipHorizontal) localX = 7 - localX;
+    line.composite(output, dots, palettes, minPos);
+  }
 
-        color = slices[i].row[localX]; // The color this sprite would draw
+  /** Returns the \c ScanLineMode of the current scan line. */
+  int scanLineMode() const {
+    int mode = 0;
 
-        if (color) { // Found something?
-          palette = s.palette;
-          noPriority = s.flags & NoPriority;
-          break; // Even a no-priority sprite takes precedence
-        }
-      }
+    if (this->vram->mask.testFlag(EnableBackground)) {
+      mode |= ModeBackground;
+      if (!this->vram->mask.testFlag(ShowBackgroundLeftmost)) mode |= ModeClipBackground;
+      if (this->vram->scrollX.fine) mode |= ModeFineX;
+    }
 
-      // Apply this dot.
-      if (color) {
-        if (!noPriority || !bitTest(dots, x)) // Respect priority
-          output[x] = palettes[palette].argb(color);
-      }
+    if (this->vram->mask.testFlag(EnableSprites)) {
+      mode |= ModeSprites;
+      if (this->vram->control.testFlag(BigSprites)) mode |= ModeBigSprites;
+      if (!this->vram->mask.testFlag(ShowSpritesLeftmost)) mode |= ModeClipSprites;
     }
+
+    return mode;
   }
 
   /**
-   * Draws the current scan line into the frame buffer.
+   * Draws the current scan line into the frame buffer, with the \c Mode
+   * being a combination of \c ScanLineMode bits.
    */
-  void handleVisibleScanLine() {
+  template<int Mode>
+  void drawScanLine() {
+    constexpr bool background = Mode & ModeBackground;
+    constexpr bool sprites = Mode & ModeSprites;
+
     // Bitmap of dots in this scan line.  While drawing the background, we put
     // a 1 for an opaque pixel (Color != 0), and a 0 for an "insivible" pixel
     // (Color = 0, the backdrop color).  Add an extra byte to account for an
     // extra tile for fine-X scrolling.
-    uint8_t dots[Renderer::WIDTH / 8 + 1]; // 256 / 8 + 1 = 65
+    uint8_t dots[Renderer::WIDTH / 8 + 1] = { }; // 256 / 8 + 1 = 65
 
-    ScanLineTiles bg = this->analyzeScanLineNameTable();
-    ScanLineSprites sprites = this->analyzeScanLineSprites();
+    // The mapper may have switched CHR banks since the last scan line.
+    this->vram->tiles.update();
 
-    if (bg.enabled) this->drawBackground(bg, dots);
-    if (sprites.enabled) this->drawSprites(sprites, dots, bg.enabled);
+    if (background) {
+      ScanLineTiles bg = this->analyzeScanLineNameTable<Mode>();
+      this->drawBackground<Mode>(bg, dots);
+    }
 
-    // If neither background nor sprite rendering is enabled, fill the screen
-    // with the backdrop color.
-    if (!bg.enabled && !sprites.enabled) {
-      uint32_t color = this->vram->palette(0).argb(0); // Get backdrop color
-      for (int i = 0; i < Renderer::WIDTH * Renderer::HEIGHT; i++) this->pixels[i] = color;
+    if (sprites) {
+      ScanLineSprites list = this->analyzeScanLineSprites((Mode & ModeBigSprites) ? 16 : 8);
+      this->drawSprites<Mode>(list, dots);
     }
 
+    // If neither background nor sprite rendering is enabled, fill the scan
+    // line with the backdrop color.
+    if (!background && !sprites) {
+      uint8_t color = this->vram->palette(0).colors[0]; // Get backdrop color
+      ::memset(this->pixels + this->scanLine * Renderer::WIDTH, color, Renderer::WIDTH);
+    }
+  }
+
+  /**
+   * Emulates the current scan line without drawing it, with the \c Mode being
+   * a combination of \c ScanLineMode bits.  Only does what the CPU can
+   * observe: Setting the sprite overflow and sprite 0 hit flags.
+   */
+  template<int Mode>
+  void skipScanLine() {
+    constexpr bool background = Mode & ModeBackground;
+    constexpr int height = (Mode & ModeBigSprites) ? 16 : 8;
+    if (!(Mode & ModeSprites)) return;
+
+    const SpriteTable &table = this->updateSpriteTable(height);
+    if (table.overflow[this->scanLine]) this->vram->status.setFlag(SpriteOverflow, true);
+
+    // Sprite 0 can only hit the background if it's in this scan line, and if
+    // it didn't hit already in this frame.
+    if (!background || !table.count[this->scanLine] || table.sprites[this->scanLine][0] != 0) return;
+    if (this->vram->status.testFlag(SpriteHit)) return;
+
+    this->vram->tiles.update();
+    Sprite s = spriteFromOam(0, this->vram->sprites()[0], this->scanLine);
+    TileSlice slice = this->spriteSlice<height>(s);
+    if (slice.value == 0) return;
+
+    // Only the opacity of the two background tiles below the sprite is needed.
+    ScanLineTiles bg = this->analyzeScanLineNameTable<Mode>();
+    int patterns = this->backgroundPatternTable();
+    int columnCount = NAMETABLE_COLUMNS + !!(Mode & ModeFineX);
+    uint8_t dots[Renderer::WIDTH / 8 + 1] = { };
+
+    for (int column = s.x / 8; column <= s.x / 8 + 1 && column < columnCount; column++) {
+      dots[column] = Compositor::opaqueBits(this->tileSlice(patterns, bg.tiles[column], bg.y).value);
+    }
+
+    this->clipBackgroundDots<Mode>(dots, bg.x);
+    this->sprite0HitTest(s.x, slice, dots);
+  }
+
+  typedef void (RendererPrivate::*ScanLineFunc)();
+
+  template<int ... Modes>
+  static constexpr std::array<ScanLineFunc, MODE_COUNT> scanLineFuncs(std::integer_sequence<int, Modes...>) {
+    return {{ &RendererPrivate::drawScanLine<Modes>... }};
+  }
+
+  template<int ... Modes>
+  static constexpr std::array<ScanLineFunc, MODE_COUNT> skipLineFuncs(std::integer_sequence<int, Modes...>) {
+    return {{ &RendererPrivate::skipScanLine<Modes>... }};
+  }
+
+  /**
+   * Draws the current scan line into the frame buffer, using the routine
+   * specialized for the current mode.  Only emulates it if \c skipRaster is
+   * set, or if the render \c thread draws it instead.
+   */
+  void handleVisibleScanLine() {
+    static constexpr std::array<ScanLineFunc, MODE_COUNT> funcs =
+        scanLineFuncs(std::make_integer_sequence<int, MODE_COUNT>());
+    static constexpr std::array<ScanLineFunc, MODE_COUNT> skipFuncs =
+        skipLineFuncs(std::make_integer_sequence<int, MODE_COUNT>());
+
+    bool draw = !this->skipRaster && !this->thread;
+    const std::array<ScanLineFunc, MODE_COUNT> &table = draw ? funcs : skipFuncs;
+    (this->*table[this->scanLineMode()])();
+
+    if (this->thread && !this->skipRaster) this->vram->logScanLine(this->scanLine);
+
 #ifdef DEBUG_SPRITES
     drawSpriteDebug(DEBUG_SPRITES);
 #endif
@@ -400,7 +585,7 @@ struct RendererPrivate {
     return (offset >= WIDTH * HEIGHT) ? (WIDTH * HEIGHT) - 1 : offset;
   }
 
-  void drawSpriteDebug(uint32_t color) {
+  void drawSpriteDebug(uint8_t color) {
     const OamSprite *sprites = this->vram->sprites();
     for (int i = 0; i < SPRITE_COUNT; i++) {
       OamSprite s = sprites[i];
@@ -421,9 +606,57 @@ struct RendererPrivate {
   /**
    * Post phase, after which all visible scan lines have been drawn.
    * This method notifies the front-end of the finished frame to be displayed.
+   * If a render thread draws the frames, it's the newest one it finished.
    */
   void handlePostScanLine() {
-    this->surfaces->displayFrameBuffer(this->pixels);
+    const uint8_t *frame = this->pixels;
+    if (this->thread) frame = this->finishThreadedFrame();
+    if (this->skipRaster || !frame) return; // Nothing new to display
+
+    if (this->target) {
+      this->presentTarget(frame);
+    } else if (this->surfaces->frameFormat() == SurfaceManager::Indexed) {
+      this->surfaces->displayIndexedFrame(frame);
+    } else {
+      Compositor::indexedToArgb(frame, this->argb, FRAME_SIZE);
+      this->surfaces->displayFrameBuffer(this->argb);
+    }
+  }
+
+  const uint8_t *finishThreadedFrame();
+
+  /**
+   * Takes the buffer of the next frame from the front-end, if it provides
+   * them.
+   */
+  void acquireTarget() {
+    this->target = this->surfaces->acquireFrame();
+    this->updatePixels();
+  }
+
+  /**
+   * Makes indexed frames drawn straight into the buffer of the front-end, if
+   * there is one.  Frames drawn on the render thread are copied instead.
+   */
+  void updatePixels() {
+    bool direct = this->target && !this->thread
+                  && this->surfaces->frameFormat() == SurfaceManager::Indexed;
+    this->pixels = direct ? static_cast<uint8_t *>(this->target) : this->frame;
+  }
+
+  /**
+   * Hands the finished \a frame to the front-end in the buffer it provided,
+   * and takes the next one.
+   */
+  void presentTarget(const uint8_t *frame) {
+    if (this->surfaces->frameFormat() == SurfaceManager::Indexed) {
+      if (frame != this->target) ::memcpy(this->target, frame, FRAME_SIZE);
+    } else {
+      Compositor::indexedToArgb(frame, static_cast<uint32_t *>(this->target), FRAME_SIZE);
+    }
+
+    this->surfaces->presentFrame(this->target);
+    this->acquireTarget();
   }
 
   /**
@@ -444,8 +677,9 @@ struct RendererPrivate {
   void handleNmiScanLine() {
     this->vram->status.setFlag(Ppu::VBlankStart, true);
 
+    // The core takes the NMI by itself as soon as it resumes.
     if (this->vram->control.testFlag(Ppu::NmiEnabled)) {
-      this->cpu->interrupt(Cpu::NonMaskable);
+      this->cpu->raise(Cpu::NonMaskable);
     }
   }
 
@@ -468,15 +702,27 @@ struct RendererPrivate {
     }
   }
 
+  /**
+   * Returns the next scan line which has to be processed in time.  The scan
+   * lines between the NMI and the pre-render line don't do anything the CPU
+   * could notice, so they're caught up on along with the pre-render line.
+   */
+  int nextEventLine() const {
+    if (this->scanLine > NMI_LINE && this->scanLine < this->preRenderLine)
+      return this->preRenderLine;
+
+    return this->scanLine;
+  }
+
   /** Processes the next scan line. */
   bool nextScanLine() {
-    if (this->scanLine < 240) {
+    if (this->scanLine < POST_LINE) {
       handleVisibleScanLine();
-    } else if (this->scanLine == 240) {
+    } else if (this->scanLine == POST_LINE) {
       handlePostScanLine();
-    } else if (this->scanLine == 241) {
+    } else if (this->scanLine == NMI_LINE) {
       handleNmiScanLine();
-    } else if (this->scanLine == 261) {
+    } else if (this->scanLine == this->preRenderLine) {
       handlePreScanLine();
       this->scanLine = 0;
       return true;
@@ -489,10 +735,121 @@ struct RendererPrivate {
 
   void reset() {
     this->scanLine = 0;
-    ::memset(this->pixels, 0, sizeof(this->pixels));
+    this->spriteTable.height = 0; // Force a rebuild
+    this->tileRow.key = -1;
+    ::memset(this->frame, 0, sizeof(this->frame));
+  }
+};
+
+/**
+ * Draws the frames on a separate thread, while the CPU emulates the next one.
+ *
+ * The PPU memory logs all writes into it to the \c log, together with the
+ * register state of each visible scan line.  The thread replays it into the
+ * \c shadow memory, and draws the scan lines from it as they come in.
+ * Finished frames are handed back through the \c frames triple buffer.
+ */
+struct RenderThread {
+  Memory *vram;
+  std::shared_ptr<Cartridge::Shadow> cartridge;
+  Memory shadow;
+  RendererPrivate rasterizer;
+  WriteLog log;
+  TripleBuffer frames;
+  std::thread thread;
+
+  RenderThread(Memory *live)
+    : vram(live), cartridge(std::make_shared<Cartridge::Shadow>(live->cartridge())),
+      shadow(cartridge), frames(RendererPrivate::FRAME_SIZE)
+  {
+    this->rasterizer.vram = &this->shadow;
+    this->rasterizer.surfaces = nullptr;
+    this->rasterizer.cpu = nullptr;
+    this->rasterizer.reset();
+    this->rasterizer.pixels = this->frames.back();
+
+    this->sync();
+    this->thread = std::thread(&RenderThread::run, this);
+  }
+
+  ~RenderThread() {
+    this->vram->setWriteLog(nullptr);
+    this->log.close();
+    this->thread.join();
+  }
+
+  /**
+   * Copies the state of the PPU memory into the \c shadow, and starts
+   * logging changes to it from there on.
+   */
+  void sync() {
+    this->log.drain(); // The thread waits for more from here on
+
+    this->cartridge->sync();
+    this->shadow.control = this->vram->control;
+    this->shadow.mask = this->vram->mask;
+    ::memcpy(this->shadow.ram, this->vram->ram, sizeof(this->shadow.ram));
+    ::memcpy(this->shadow.oam, this->vram->oam, sizeof(this->shadow.oam));
+    ::memcpy(this->shadow.palettes, this->vram->palettes, sizeof(this->shadow.palettes));
+    this->shadow.nameTableGeneration++;
+    this->shadow.oamGeneration++;
+
+    // CHR RAM copies may have changed under the decoded tiles.
+    for (int address = 0; address < NAME_TABLE_BASE; address += 16) {
+      this->shadow.tiles.invalidate(address);
+    }
+
+    this->vram->setWriteLog(&this->log);
+  }
+
+  /** Logs the end of the frame, and returns the newest finished one. */
+  const uint8_t *finishFrame(bool skipped) {
+    if (!skipped) this->log.append(WriteLog::Entry(WriteLog::FrameEnd, 0));
+    this->log.publish();
+
+    return skipped ? nullptr : this->frames.takeFront();
+  }
+
+  void run() {
+    WriteLog::Entry entry;
+    while (this->log.take(entry)) this->replay(entry);
+  }
+
+  void replay(const WriteLog::Entry &entry) {
+    switch (entry.type) {
+    case WriteLog::MemoryWrite:
+      this->shadow.write(entry.address, entry.value);
+      break;
+    case WriteLog::OamWrite:
+      this->shadow.oam[entry.address] = entry.value;
+      this->shadow.oamGeneration++;
+      break;
+    case WriteLog::ChrPage:
+      this->cartridge->mapPage(entry.address, entry.page);
+      break;
+    case WriteLog::NameTableMirroring:
+      this->cartridge->setNameTableMirroring(static_cast<Mirroring>(entry.value));
+      break;
+    case WriteLog::ScanLine:
+      this->shadow.control = Controls(entry.registers.control);
+      this->shadow.mask = Masks(entry.registers.mask);
+      this->shadow.scrollX.value = entry.registers.scrollX;
+      this->shadow.scrollY.value = entry.registers.scrollY;
+      this->rasterizer.scanLine = entry.address;
+      this->rasterizer.handleVisibleScanLine();
+      break;
+    case WriteLog::FrameEnd:
+      this->frames.publish();
+      this->rasterizer.pixels = this->frames.back();
+      break;
+    }
   }
 };
 
+const uint8_t *RendererPrivate::finishThreadedFrame() {
+  return this->thread->finishFrame(this->skipRaster);
+}
+
 Renderer::Renderer(Memory *vram, SurfaceManager *surfaces, Cpu::Base *cpu)
   : d(new RendererPrivate)
 {
@@ -501,14 +858,65 @@ Renderer::Renderer(Memory *vram, SurfaceManager *surfaces, Cpu::Base *cpu)
   this->d->cpu = cpu;
 
   this->d->reset();
+  this->d->acquireTarget();
 }
 
 Renderer::~Renderer() {
+  delete this->d->thread;
   delete this->d;
 }
 
 bool Renderer::drawScanLine() {
+  int line = this->d->nextEventLine();
+  while (this->d->scanLine < line) this->d->nextScanLine();
+
   return this->d->nextScanLine();
 }
 
+int Renderer::nextScanLine() const {
+  return this->d->nextEventLine();
+}
+
+void Renderer::setScanLineCount(int count) {
+  this->d->preRenderLine = count - 1;
+}
+
+bool Renderer::skipRaster() const {
+  return this->d->skipRaster;
+}
+
+void Renderer::setSkipRaster(bool skip) {
+  this->d->skipRaster = skip;
+}
+
+bool Renderer::isThreaded() const {
+  return this->d->thread != nullptr;
+}
+
+void Renderer::setThreaded(bool threaded) {
+  if (threaded == this->isThreaded()) return;
+
+  if (threaded) {
+    this->d->thread = new RenderThread(this->d->vram);
+  } else {
+    delete this->d->thread;
+    this->d->thread = nullptr;
+  }
+
+  this->d->updatePixels();
+}
+
+void Renderer::synchronize() {
+  if (this->d->thread) this->d->thread->sync();
+}
+
+void Renderer::saveState(Core::StateWriter &out) const {
+  out.write(this->d->scanLine);
+}
+
+void Renderer::loadState(Core::StateReader &in) {
+  in.read(this->d->scanLine);
+  this->synchronize();
+}
+
 }
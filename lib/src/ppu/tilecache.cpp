@@ -0,0 +1,84 @@
+#include <ppu/tilecache.hpp>
+
+namespace Ppu {
+TileCache::TileCache(Cartridge::Base *cartridge)
+  : m_cartridge(cartridge)
+{
+  this->update();
+}
+
+TileCache::~TileCache() {
+  // Nothing.
+}
+
+void TileCache::update() {
+  uint8_t *const *writePages = this->m_cartridge->ppuWritePages();
+
+  for (int i = 0; i < PAGE_COUNT; i++) {
+    const uint8_t *source = this->m_cartridge->chrPage(i * PAGE_SIZE);
+    Page *current = this->m_pages[i];
+
+    if (!current || current->source != source) {
+      current = this->page(source);
+      this->m_pages[i] = current;
+    }
+
+    if (writePages[i]) current->writable = true;
+  }
+}
+
+void TileCache::invalidate(int address) {
+  auto it = this->m_cache.find(this->m_cartridge->chrPage(address));
+  if (it == this->m_cache.end()) return;
+
+  int tile = (address / 16) % TILES_PER_PAGE;
+  it->second->decoded &= ~(uint64_t(1) << tile);
+}
+
+void TileCache::clear() {
+  for (auto &it : this->m_cache) {
+    if (it.second->writable) it.second->decoded = 0;
+  }
+}
+
+TileCache::Page *TileCache::page(const uint8_t *source) {
+  std::unique_ptr<Page> &page = this->m_cache[source];
+
+  if (!page) {
+    page.reset(new Page);
+    page->source = source;
+  }
+
+  return page.get();
+}
+
+/**
+ * Pattern data supports 4 different colors per pixel.  This takes two bits to
+ * represent, stored in two distinct planes.  Each plane stores one bit
+ * of color information per pixel.  Each byte stores information of 8 pixels.
+ * Each plane needing 8x8 Bits, or 8 Byte, make the second plane offset by
+ * 8 Bytes from the beginning of the pattern data.
+ *
+ * The first plane stores the low bit, the second the high bit.  The highest
+ * bit (Bit 7) corresponds to the first pixel (Pixel 0) in each row.
+ */
+void TileCache::decode(Page *page, int tile) {
+  const uint8_t *pattern = page->source + tile * 16;
+
+  for (int y = 0; y < 8; y++) {
+    int lo = pattern[y + 0];
+    int hi = pattern[y + 8];
+
+    TileSlice &slice = page->rows[tile][0][y];
+    TileSlice &flipped = page->rows[tile][1][y];
+
+    for (int i = 0; i < 8; i++) {
+      uint8_t color = ((lo >> (7 - i)) & 1) | (((hi >> (7 - i)) & 1) << 1);
+      slice.row[i] = color;
+      flipped.row[7 - i] = color;
+    }
+  }
+
+  page->decoded |= uint64_t(1) << tile;
+}
+}
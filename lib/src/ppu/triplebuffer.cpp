@@ -0,0 +1,29 @@
+#include <ppu/triplebuffer.hpp>
+
+#include <cstring>
+
+namespace Ppu {
+TripleBuffer::TripleBuffer(int size) {
+  for (std::unique_ptr<uint8_t[]> &buffer : this->m_buffers) {
+    buffer.reset(new uint8_t[size]);
+    ::memset(buffer.get(), 0, size);
+  }
+}
+
+TripleBuffer::~TripleBuffer() {
+  // Nothing.
+}
+
+void TripleBuffer::publish() {
+  int previous = this->m_middle.exchange(this->m_back | FRESH, std::memory_order_acq_rel);
+  this->m_back = previous & INDEX_MASK;
+}
+
+const uint8_t *TripleBuffer::takeFront() {
+  if (!(this->m_middle.load(std::memory_order_relaxed) & FRESH)) return nullptr;
+
+  int previous = this->m_middle.exchange(this->m_front, std::memory_order_acq_rel);
+  this->m_front = previous & INDEX_MASK;
+  return this->m_buffers[this->m_front].get();
+}
+}
@@ -0,0 +1,65 @@
+#include <ppu/writelog.hpp>
+
+namespace Ppu {
+WriteLog::WriteLog()
+  : m_entries(new Entry[CAPACITY])
+{
+}
+
+WriteLog::~WriteLog() {
+  // Nothing.
+}
+
+void WriteLog::publish() {
+  this->m_published.store(this->m_head, std::memory_order_release);
+
+  // Taking the lock makes sure the reader is either waiting already, or sees
+  // the new head before it does.
+  { std::lock_guard<std::mutex> lock(this->m_mutex); }
+  this->m_wakeReader.notify_one();
+}
+
+void WriteLog::drain() {
+  this->publish();
+
+  std::unique_lock<std::mutex> lock(this->m_mutex);
+  this->m_wakeWriter.wait(lock, [this]{
+    return this->m_consumed.load(std::memory_order_acquire) == this->m_head;
+  });
+
+  this->m_writerTail = this->m_head;
+}
+
+void WriteLog::close() {
+  std::lock_guard<std::mutex> lock(this->m_mutex);
+  this->m_closed = true;
+  this->m_wakeReader.notify_one();
+}
+
+void WriteLog::waitForSpace() {
+  this->publish();
+
+  std::unique_lock<std::mutex> lock(this->m_mutex);
+  this->m_wakeWriter.wait(lock, [this]{
+    this->m_writerTail = this->m_consumed.load(std::memory_order_acquire);
+    return this->m_head - this->m_writerTail < CAPACITY;
+  });
+}
+
+bool WriteLog::refill() {
+  // All entries taken so far have been processed by now.
+  this->m_consumed.store(this->m_tail, std::memory_order_release);
+  this->m_readerHead = this->m_published.load(std::memory_order_acquire);
+  if (this->m_readerHead != this->m_tail) return true;
+
+  // Out of entries: Wake up a writer waiting for us, and wait for more.
+  std::unique_lock<std::mutex> lock(this->m_mutex);
+  this->m_wakeWriter.notify_one();
+  this->m_wakeReader.wait(lock, [this]{
+    this->m_readerHead = this->m_published.load(std::memory_order_acquire);
+    return this->m_readerHead != this->m_tail || this->m_closed;
+  });
+
+  return this->m_readerHead != this->m_tail;
+}
+}
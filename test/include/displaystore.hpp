@@ -9,7 +9,8 @@ namespace Test {
 
 /**
  * Surface manager for the NES PPU storing the most current frame.  Used so it
- * can be compared to an image a casette provides.
+ * can be compared to an image a casette provides.  The renderer writes each
+ * frame straight into its buffer.
  */
 class DisplayStore : public Ppu::SurfaceManager {
 public:
@@ -28,7 +29,7 @@ public:
   /** Height of the frame in pixel. */
   size_t height() const;
 
-  void displayFrameBuffer(uint32_t *buffer) override;
+  void *acquireFrame() override;
 private:
   uint8_t *m_frame;
 };
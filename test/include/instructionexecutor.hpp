@@ -24,6 +24,9 @@ private:
   bool advance(QStringList &args);
   bool compare(const QStringList &args);
   bool saveFrame(const QStringList &args);
+  bool benchmark(const QStringList &args);
+  bool drawBenchmark(const QStringList &args);
+  bool lockStep(const QStringList &args);
 
   QString replaceVariables(QString templ);
 
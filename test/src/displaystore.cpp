@@ -31,7 +31,7 @@ size_t DisplayStore::height() const {
   return Ppu::Renderer::HEIGHT;
 }
 
-void DisplayStore::displayFrameBuffer(uint32_t *buffer) {
-  ::memcpy(this->m_frame, buffer, FRAME_BYTE_SIZE);
+void *DisplayStore::acquireFrame() {
+  return this->m_frame; // Frames are only looked at between ticks.
 }
 }
@@ -1,13 +1,20 @@
 #include <instructionexecutor.hpp>
 
 #include <core/runner.hpp>
+#include <core/timing.hpp>
+#include <cpu/base.hpp>
 #include <cpu/memory.hpp>
+#include <interpret/core_interpret.hpp>
+#include <interpret/lockstep.hpp>
 
 #include <bmpfile.hpp>
 #include <displaystore.hpp>
 
+#include <QElapsedTimer>
 #include <QFile>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace Test {
 InstructionExecutor::InstructionExecutor(std::unique_ptr<Core::Runner> runner, DisplayStore *display)
@@ -27,6 +34,9 @@ bool InstructionExecutor::execute(const QString &instruction) {
   if (command == "advance") return this->advance(parts);
   if (command == "compare") return this->compare(parts);
   if (command == "frame") return this->saveFrame(parts);
+  if (command == "benchmark") return this->benchmark(parts);
+  if (command == "drawbenchmark") return this->drawBenchmark(parts);
+  if (command == "lockstep") return this->lockStep(parts);
 
   std::cout << "!! ERROR: Unknown command " << command.toStdString() << "\n";
   return false;
@@ -118,6 +128,154 @@ bool InstructionExecutor::saveFrame(const QStringList &args) {
   return true;
 }
 
+bool InstructionExecutor::benchmark(const QStringList &args) {
+  if (args.size() != 2) {
+    std::cout << "!! The BENCHMARK command requires two arguments.\n";
+    return false;
+  }
+
+  int frameCount = args.at(0).toInt();
+  int maxAhead = args.at(1).toInt();
+  double baseline = 0.0;
+
+  // Time the same frames with every run-ahead count, starting from the same
+  // state each time.
+  QByteArray state(this->m_runner->stateSize(), 0);
+  uint8_t *stateData = reinterpret_cast<uint8_t *>(state.data());
+  this->m_runner->saveState(stateData);
+
+  for (int ahead = 0; ahead <= maxAhead; ahead++) {
+    this->m_runner->loadState(stateData, state.size());
+    this->m_runner->setRunAhead(ahead);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < frameCount; i++) {
+      this->m_runner->tick();
+    }
+
+    double perFrame = timer.nsecsElapsed() / 1000.0 / frameCount;
+    if (ahead == 0) baseline = perFrame;
+
+    std::cout << "   Run-ahead " << ahead << ": " << perFrame << "us per frame";
+    if (ahead > 0) std::cout << ", +" << (perFrame - baseline) / ahead << "us per extra frame";
+    std::cout << "\n";
+  }
+
+  this->m_runner->setRunAhead(0);
+  return true;
+}
+
+bool InstructionExecutor::drawBenchmark(const QStringList &args) {
+  if (args.size() != 1) {
+    std::cout << "!! The DRAWBENCHMARK command requires a single argument.\n";
+    return false;
+  }
+
+  int frameCount = args.at(0).toInt();
+  double perFrame[2];
+
+  // Time the same frames drawn and with the raster skipped, starting from the
+  // same state each time.  The difference is the cost of drawing a frame.
+  QByteArray state(this->m_runner->stateSize(), 0);
+  uint8_t *stateData = reinterpret_cast<uint8_t *>(state.data());
+  this->m_runner->saveState(stateData);
+
+  for (int skip = 1; skip >= 0; skip--) {
+    this->m_runner->loadState(stateData, state.size());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < frameCount; i++) {
+      this->m_runner->tick(skip == 1);
+    }
+
+    perFrame[skip] = timer.nsecsElapsed() / 1000.0 / frameCount;
+  }
+
+  std::cout << "   Skipped: " << perFrame[1] << "us per frame\n"
+            << "   Drawn: " << perFrame[0] << "us per frame, +"
+            << (perFrame[0] - perFrame[1]) << "us for drawing\n";
+  return true;
+}
+
+bool InstructionExecutor::lockStep(const QStringList &args) {
+  if (args.size() != 2) {
+    std::cout << "!! The LOCKSTEP command requires two arguments.\n";
+    return false;
+  }
+
+  int lanes = args.at(0).toInt();
+  int frameCount = args.at(1).toInt();
+  int frameCycles = static_cast<int>(this->m_runner->timing().cpuCycles(this->m_runner->timing().frameLength()));
+
+  // Run the CPUs of two sets of forks, giving each lane other input.  Only the
+  // CPU is run, so an NMI is raised at the start of each frame in its stead.
+  std::vector<std::unique_ptr<Core::Runner>> forks;
+  for (int i = 0; i < 2 * lanes; i++) {
+    forks.emplace_back(this->m_runner->fork(this->m_display));
+    forks.back()->ram()->firstPlayer().setButtons(static_cast<uint8_t>((i % lanes) * 37));
+  }
+
+  std::vector<std::unique_ptr<Interpret::Core>> cores;
+  for (int i = 0; i < lanes; i++) {
+    Cpu::Base *cpu = forks[i]->cpu();
+    cores.emplace_back(new Interpret::Core(cpu->mem(), cpu->state()));
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  for (auto &core : cores) {
+    for (int frame = 0; frame < frameCount; frame++) {
+      core->raise(Cpu::NonMaskable);
+      core->run(frameCycles);
+    }
+  }
+
+  double interpretTime = timer.nsecsElapsed() / 1e9;
+
+  std::vector<Cpu::Memory *> memories;
+  for (int i = 0; i < lanes; i++) {
+    memories.push_back(forks[lanes + i]->ram());
+  }
+
+  Interpret::LockStep lockStep(memories);
+  for (int i = 0; i < lanes; i++) {
+    lockStep.setState(i, forks[lanes + i]->cpu()->state());
+  }
+
+  timer.restart();
+
+  for (int frame = 0; frame < frameCount; frame++) {
+    for (int i = 0; i < lanes; i++) lockStep.raise(i, Cpu::NonMaskable);
+    lockStep.run(frameCycles);
+  }
+
+  double lockStepTime = timer.nsecsElapsed() / 1e9;
+
+  // Both ran the same instructions if they ended up in the same state.
+  for (int i = 0; i < lanes; i++) {
+    Cpu::State expected = cores[i]->state();
+    Cpu::State actual = lockStep.state(i);
+
+    if (expected.a != actual.a || expected.x != actual.x || expected.y != actual.y ||
+        expected.s != actual.s || expected.p != actual.p || expected.pc != actual.pc ||
+        ::memcmp(forks[i]->ram()->ram(), forks[lanes + i]->ram()->ram(), Cpu::Memory::RAM_SIZE) != 0) {
+      std::cout << "   Lane " << i << " differs from the interpreter!\n";
+      return false;
+    }
+  }
+
+  double instructions = static_cast<double>(lockStep.instructions());
+  std::cout << "   " << lanes << " interpreters: " << instructions / interpretTime / 1e6 << " M instructions/s\n"
+            << "   Lock-step, " << lockStep.width() << " lanes wide: " << instructions / lockStepTime / 1e6
+            << " M instructions/s, " << instructions / lockStep.dispatches() << " lanes per instruction\n";
+  return true;
+}
+
 QString InstructionExecutor::replaceVariables(QString templ) {
   return templ.replace('%', this->m_runner->cpuImplementation());
 }